@@ -7,6 +7,8 @@
 #include "Utils/Timer.h"
 
 #define BASEFPS 60
+#define DEFAULT_FIXED_STEP_HZ 60
+#define DEFAULT_MAX_FIXED_STEPS 5
 
 enum ApplicationState
 {
@@ -25,6 +27,17 @@ private:
 	float dt;
 	float fps_cap = 60;
 	float last_frame_ms;
+
+	//simulation steps per second
+	float fixed_step_hz = DEFAULT_FIXED_STEP_HZ;
+	//steps run at most in one frame, the time left over is dropped
+	int max_fixed_steps = DEFAULT_MAX_FIXED_STEPS;
+	//time that has passed and has not been simulated yet
+	float accumulated_ms = 0;
+	//how far the rendered frame is between the last step and the next one, from 0 to 1
+	float interpolation_alpha = 0;
+	//set while the parts run their FixedLoop
+	bool in_fixed_step = false;
 public:
 
 	//thread blocking call until the engine has finished running
@@ -45,6 +58,8 @@ public:
 	Timer update_timer;
 	void LoadConfig(const char* filename);
 	float GetLastUpdateTime() { return dt; }
+	float GetInterpolationAlpha() { return interpolation_alpha; }
+	bool IsInFixedStep() { return in_fixed_step; }
 
 	EngineAPI* mAPI;
 	friend class EngineAPI;
@@ -84,6 +84,10 @@ public:
 
 	void Quit() {};
 	float GetLastUpdateTime() { return mApplication->GetLastUpdateTime(); };
+	//how far the frame being rendered is between the last simulation step and the next one
+	float GetInterpolationAlpha() { return mApplication->GetInterpolationAlpha(); };
+	//true while the simulation steps run, before the Loop of the frame
+	bool IsInFixedStep() { return mApplication->IsInFixedStep(); };
 
 	friend class Application;
 };
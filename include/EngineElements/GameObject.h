@@ -7,6 +7,10 @@
 
 class ObjectManager;
 class SceneController;
+class FactoryBase;
+
+//index of the object's slot in the low bits and the slot generation in the high bits, 0 is never a valid handle
+typedef unsigned int ObjectHandle;
 
 /*this is the main class that should be INHERITED to create custom behaviours of objects
 IMPORTANT: during the constructor and destructor the object's reference to the engine has not been initialized,
@@ -17,13 +21,19 @@ class DLL_EXPORT GameObject
 public:
 	//the collider is the main presence of the object inside of the engine
 	RXRect collider;
+	//bits of the layers the object is in
+	unsigned int collision_layer = 1;
+	//bits of the layers the object collides with, two objects collide if each one's layer is in the other's mask
+	unsigned int collision_mask = 0xFFFFFFFF;
+	//keeps updating and rendering the object when it is away from the camera
+	bool always_active = false;
 	std::type_index mType = std::type_index(typeid(*this));
 
 	//function that is called right after the engine creates the gameobject
 	virtual void Init() {};
-	//function that is called every frame, it gives the Delta Time as an argument
+	//function that is called every simulation step, it gives the Delta Time of the step as an argument
 	virtual bool Loop(float dt) { return true; };
-	//function that is called every frame, especially for rendering events
+	//function that is called every frame, especially for rendering events, the collider is placed between its last two steps during the call
 	virtual bool Render() { return true; };
 	//function that is called every frame when the debug visualization is active
 	virtual void RenderDebug() {};
@@ -49,10 +59,21 @@ public:
 		return (dynamic_cast<T*>(this) != NULL);
 	}
 
+	//returns the handle that identifies the object while it is in the scene, 0 if it was not added
+	ObjectHandle GetHandle() { return mHandle; }
+
 	friend class ObjectManager;
 	friend class SceneController;
+	friend class FactoryBase;
 protected:
 	EngineAPI* Engine = nullptr;
+private:
+	//factory whose pool holds the object, nullptr if it was created with new
+	FactoryBase* mFactory = nullptr;
+	ObjectHandle mHandle = 0;
+	//collider position before the last simulation step, used to interpolate the rendering
+	int mPreviousX = 0;
+	int mPreviousY = 0;
 };
 
 #endif
\ No newline at end of file
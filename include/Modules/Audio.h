@@ -16,9 +16,9 @@ public:
 	Audio(EngineAPI& aAPI);
 	~Audio() {};
 	
-	//loads a song and returns an ID
+	//registers a song and returns an ID, the file is loaded the first time it is played
 	AudioID LoadMusic(const char* file, float fade= 500.0f,float volume = 1.0f);
-	//loads an SFX and returns an ID
+	//registers an SFX and returns an ID, the file is loaded the first time it is played
 	AudioID LoadSFX(const char* file, float volume = 1.0f);
 
 	//plays a song
@@ -41,8 +41,10 @@ public:
 	//returns how much of the screen has been covered in %
 	int GetCoveragePercent();
 
-	//returns the area the camera covers of the map
+	//returns the area the camera covers of the map, in screen pixels
 	RXRect GetScreenArea();
+	//returns the area the camera covers of the map, in world units
+	RXRect GetWorldArea();
 private:
 
 	class CameraImpl;
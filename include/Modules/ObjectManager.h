@@ -7,8 +7,7 @@
 #include <functional>
 #include <typeindex>
 #include "../EngineElements/GameObject.h"
-
-#define MAX_WALLS 500
+#include "../Utils/ObjectPool.h"
 
 struct ObjectProperty
 {
@@ -19,36 +18,68 @@ struct ObjectProperty
 };
 
 
+/*specialize with value = true for the object types whose Loop only changes the object itself
+they are updated across threads when the parallel update is enabled, adding or deleting objects and walls from their Loop is applied after all of them are updated*/
+template<class T>
+struct ThreadSafeLoop
+{
+	static const bool value = false;
+};
+
 //do not use this class, it exists to have the factory as a template class in a list
 class DLL_EXPORT FactoryBase
 {
 public:
 	FactoryBase() {};
 	FactoryBase(const char* nameInMap){};
+	virtual ~FactoryBase() {};
 
 	virtual GameObject* CreateInstace() { return nullptr; };
 	virtual GameObject* CreateInstace(std::list<ObjectProperty*>&) { return nullptr; };
+	//gives back an object created by this factory
+	virtual void DestroyInstance(GameObject* aObject) { delete aObject; };
+	//makes room for that many objects so they can be created without allocating
+	virtual void Prewarm(int aCount) {};
+	//returns true if the Loop of the objects can run in parallel with other objects
+	virtual bool IsThreadSafe() { return false; };
 
 	virtual std::string GetObjectMapName() { return "ERRORTYPE"; };
 	virtual std::type_index GetObjectTypeIndex() { return std::type_index(typeid(this)); };
+
+	static FactoryBase* GetFactoryOf(GameObject* aObject) { return aObject->mFactory; }
+
+protected:
+	static void SetFactoryOf(GameObject* aObject, FactoryBase* aFactory) { aObject->mFactory = aFactory; }
 };
 
 template<typename T> 
 
 //a factory to enable the creation of the objects, initialize with the name it will look for in the map
+//the objects are allocated from a pool owned by the factory and recycled when they are deleted
 class DLL_EXPORT Factory : public FactoryBase
 {
 private:
 	std::string mNameInMap;
+	ObjectPool<T> mPool;
 public:
 	Factory() {};
-	Factory(const char* nameInMap) :mNameInMap(nameInMap) {};
+	Factory(const char* nameInMap, int aSlabSize = OBJECT_POOL_DEFAULT_SLAB_SIZE) :mNameInMap(nameInMap), mPool(aSlabSize) {};
 
-	GameObject* CreateInstace() { return new T(); };
+	GameObject* CreateInstace()
+	{
+		T* lObject = mPool.New();
+		SetFactoryOf(lObject, this);
+		return lObject;
+	};
 	GameObject* CreateInstace(std::list<ObjectProperty*>& lProps)
 	{
-		return new T(lProps); 
+		T* lObject = mPool.New(lProps);
+		SetFactoryOf(lObject, this);
+		return lObject;
 	};
+	void DestroyInstance(GameObject* aObject) { mPool.Delete(static_cast<T*>(aObject)); };
+	void Prewarm(int aCount) { mPool.Reserve(aCount); };
+	bool IsThreadSafe() { return ThreadSafeLoop<T>::value; };
 
 	std::type_index GetObjectTypeIndex() { return std::type_index(typeid(T)); };
 	std::string GetObjectMapName() { return mNameInMap; };
@@ -59,6 +90,28 @@ struct collision
 	GameObject* object;
 };
 
+//two objects whose colliders overlap
+struct collision_pair
+{
+	GameObject* object;
+	GameObject* other;
+};
+
+//something found by a raycast or a sweep
+struct raycast_hit
+{
+	//object that was hit, nullptr if it was a wall
+	GameObject* object = nullptr;
+	//wall that was hit, nullptr if it was an object
+	RXRect* wall = nullptr;
+	//where the ray stopped, for sweeps where the rect is placed when it touches
+	float x = 0, y = 0;
+	//points out of the face that was hit, 0,0 if the ray or rect started inside
+	float normal_x = 0, normal_y = 0;
+	//how much of the movement was done before the hit, from 0 to 1
+	float fraction = 0;
+};
+
 //module that handles all of the objects and their functionality
 class DLL_EXPORT ObjectManager : public Part
 {
@@ -73,15 +126,40 @@ public:
 	//returns the colliders that are in the range specified, using the coordinates recieved as the center
 	void GetNearbyWalls(int x, int y, int pxls_range, std::vector<RXRect*>& colliders_near);
 
-	//returns all objects containing the type specified
+	//returns all objects containing the type specified, the vector is a copy that has to be deleted
 	std::vector<GameObject*>* GetAllObjectsOfType(std::type_index);
+	//returns the objects of that type without copying them, the vector belongs to the manager and changes when objects are added or deleted
+	const std::vector<GameObject*>& GetObjectsOfType(std::type_index);
+	template<class T>
+	const std::vector<GameObject*>& GetObjectsOfType()
+	{
+		return GetObjectsOfType(std::type_index(typeid(T)));
+	}
 
 	//returns all collisions with that rectangle
 	void GetCollisions(RXRect* rect,std::vector<collision*>&collisions);
 	//clears the collision array that was recieved in the previous function
 	void ClearCollisionArray(std::vector<collision*>&collisions);
-
-	//adds a collider
+	//adds the objects colliding with that rectangle whose layer is in the mask to the vector, nothing has to be freed afterwards
+	void GetCollisions(const RXRect& rect, std::vector<GameObject*>& collisions, unsigned int mask = 0xFFFFFFFF);
+
+	//returns the pairs of objects that collided at the start of the frame, each pair appears twice, once for each object, sorted by object
+	const std::vector<collision_pair>& GetCollisionPairs();
+	//adds the objects that collided with this one at the start of the frame to the vector
+	void GetCollisionPairsOf(GameObject* object, std::vector<GameObject*>& others);
+
+	//finds the closest wall or object crossed by the segment, objects are filtered by the mask and the ignored one, returns false if nothing was hit
+	bool Raycast(float x1, float y1, float x2, float y2, raycast_hit& hit, unsigned int mask = 0xFFFFFFFF, bool walls = true, GameObject* ignore = nullptr);
+	//adds everything crossed by the segment to the vector sorted by distance and returns how many hits were added
+	int RaycastAll(float x1, float y1, float x2, float y2, std::vector<raycast_hit>& hits, unsigned int mask = 0xFFFFFFFF, bool walls = true, GameObject* ignore = nullptr);
+	//moves the rect by dx,dy and finds the first wall or object it touches, returns false if nothing was hit
+	bool SweepRect(const RXRect& rect, float dx, float dy, raycast_hit& hit, unsigned int mask = 0xFFFFFFFF, bool walls = true, GameObject* ignore = nullptr);
+	//adds everything the moving rect touches to the vector sorted by distance and returns how many hits were added
+	int SweepRectAll(const RXRect& rect, float dx, float dy, std::vector<raycast_hit>& hits, unsigned int mask = 0xFFFFFFFF, bool walls = true, GameObject* ignore = nullptr);
+	//adds the objects in the mask and the walls that overlap the circle to the vectors and returns how many were added
+	int OverlapCircle(float x, float y, float radius, std::vector<GameObject*>& objects, std::vector<RXRect*>& walls, unsigned int mask = 0xFFFFFFFF);
+
+	//adds a collider, during the parallel update it is added afterwards and -1 is returned
 	int AddWall(RXRect& rect);
 	//removes a collider
 	void DeleteWall(int id);
@@ -93,7 +171,7 @@ public:
 	//returns true if objects have been paused
 	bool isPaused();
 
-	//adds a new object with that type and properties and returns it
+	//adds a new object with that type and properties and returns it, during the parallel update the object is created afterwards and nullptr is returned
 	GameObject* AddObject(int x, int y, int w_col, int h_col,std::type_index lType);
 	//adds an already existing object into the engine
 	void AddObject(GameObject*);
@@ -101,6 +179,18 @@ public:
 	//returns the count of all objects
 	int GetTotalObjectNumber();
 
+	//returns the object with that handle, nullptr if it was deleted
+	GameObject* GetObjectFromHandle(ObjectHandle aHandle);
+	//returns true if the object with that handle is still in the scene
+	bool IsObjectAlive(ObjectHandle aHandle);
+	//returns the collider where the object is drawn this frame, between its last two simulation steps
+	RXRect GetInterpolatedCollider(GameObject* object);
+
+	//returns false if the object is too far from the camera and skips Loop and Render
+	bool IsObjectAwake(GameObject* object);
+	//pixels around the screen where objects stay awake, only used when the activation is enabled in the config
+	void SetActivationMargin(int margin);
+
 	//adds a factory to enable the creation of the objects
 	bool AddFactory(FactoryBase* lFactory);
 
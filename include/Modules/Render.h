@@ -22,9 +22,24 @@ enum RenderQueue
 };
 
 
+//kind of render command, used to dispatch the blit without virtual calls
+enum BlitType
+{
+	BLIT_TEXTURE = 0,
+	BLIT_TEXT,
+	BLIT_LAYER,
+	BLIT_BACKGROUND,
+	BLIT_PARTICLES,
+	BLIT_RECT,
+	BLIT_TRAIL
+};
+
+//plain render command, they live in a per frame arena and are never deleted individually
 class BlitItem
 {
 public:
+	BlitType type;
+
 	//position
 	int x;
 	int y;
@@ -40,8 +55,6 @@ public:
 
 	bool ignore_camera = false;
 
-	virtual void Blit(Render& aRender, Camera& camera, Window& aWindow) = 0;
-
 	void SetPosition(int aX, int aY)
 	{
 		x = aX;
@@ -60,15 +73,6 @@ public:
 	}
 };
 
-class Comparer
-{
-public:
-	bool operator() (BlitItem* itemA, BlitItem* itemB)
-	{
-		return itemB->depth > itemA->depth;
-	}
-};
-
 struct SDL_Renderer;
 
 //module that handles graphic processing
@@ -19,11 +19,28 @@ public:
 
 	//loads a map found at that file
 	void LoadMap(const char* filename);
+	//loads a map in the background while the current one keeps running, it replaces it once it is ready
+	void LoadMapAsync(const char* filename);
+	//true while a map is loading in the background
+	bool IsLoadingMap();
+	//progress from 0 to 100 of the last map loaded in the background
+	int GetLoadProgress();
+	//parses a map in the background and keeps it in the map cache, loading it afterwards only spawns its objects
+	void PreloadMap(const char* filename);
+	//frees the maps kept in the map cache
+	void ClearMapCache();
+	//regions kept around the screen on maps with the "streaming" property, their walls and objects are the only ones in the scene
+	void SetStreamingRadius(int aRadius);
 	//removes all map elements
 	void CleanMap();
 	//returns the room's size
 	void GetRoomSize(int& x, int& y);
 
+	//changes a tile of a layer, aTileId is the index inside of the layer's tileset, -1 to leave it empty
+	void SetTile(int aLayer, int x, int y, int aTileId);
+	//returns the index inside of the layer's tileset of a tile, -1 if empty or out of the layer
+	int GetTile(int aLayer, int x, int y);
+
 	//the function given as an argument will be called every frame
 	bool AssignGameLoopFunction(std::function<void()> SceneFunction);
 	//the function given as an argument will be called every time a new scene is loaded
@@ -12,8 +12,25 @@ class DLL_EXPORT Textures : public Part
 public:
 	Textures(EngineAPI& aAPI);
 	
-	//loads a texture and returns its id for future use
+	//registers a texture and returns its id for future use, the image is loaded the first time it is used
 	TextureID Load_Texture(const char* path);
+	//registers a texture and starts decoding it in the background, it is not drawn until it is ready
+	TextureID Load_Texture_Async(const char* path);
+	//returns true once the image of the texture is in memory
+	bool Is_Texture_Ready(TextureID aTextureID);
+	//returns true while the image of the texture is waiting in the decoding pool, false once it is ready or failed
+	bool Is_Texture_Decoding(TextureID aTextureID);
+	//decodes all the textures in parallel and waits for them, the ids are written to ids_out if it is not null
+	void Load_Textures_And_Wait(const char** paths, int count, TextureID* ids_out = nullptr);
+	//returns the number of images still being decoded
+	int Get_Pending_Decodes();
+
+	//returns the bytes taken by the loaded textures
+	uint64 Get_Texture_Memory_Usage();
+	//returns the bytes of standalone textures allowed before they are evicted, 0 if there is no limit
+	uint64 Get_Texture_Memory_Budget();
+	//returns how many textures were evicted to stay under the budget
+	uint Get_Texture_Evictions();
 	//destroys a texture recieving a path
 	void Destroy_Texture(const char* texture_name);
 	//destroys a texture recieving its ID
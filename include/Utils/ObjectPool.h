@@ -0,0 +1,80 @@
+#ifndef OBJECT_POOL__H
+#define OBJECT_POOL__H
+
+#include <vector>
+#include <new>
+#include <utility>
+
+#define OBJECT_POOL_DEFAULT_SLAB_SIZE 64
+
+/*typed free list of objects, memory is requested in slabs of contiguous objects and never given back until the pool is destroyed
+objects still alive when the pool is destroyed are not destructed*/
+template<class T>
+class ObjectPool
+{
+public:
+	ObjectPool(int aSlabSize = OBJECT_POOL_DEFAULT_SLAB_SIZE) : mSlabSize(aSlabSize > 0 ? aSlabSize : OBJECT_POOL_DEFAULT_SLAB_SIZE) {};
+	~ObjectPool()
+	{
+		for (typename std::vector<void*>::iterator it = mSlabs.begin(); it != mSlabs.end(); ++it)
+		{
+			::operator delete(*it);
+		}
+	}
+
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	//constructs an object in a free slot, a new slab is added if there is none
+	template<class... Args>
+	T* New(Args&&... aArgs)
+	{
+		if (mFree.empty())
+		{
+			AddSlab();
+		}
+
+		void* lSlot = mFree.back();
+		mFree.pop_back();
+		return new (lSlot) T(std::forward<Args>(aArgs)...);
+	}
+
+	//destructs the object and keeps its slot for the next one
+	void Delete(T* aObject)
+	{
+		aObject->~T();
+		mFree.push_back(aObject);
+	}
+
+	//adds slabs until there are at least that many free slots
+	void Reserve(int aFreeSlots)
+	{
+		while ((int)mFree.size() < aFreeSlots)
+		{
+			AddSlab();
+		}
+	}
+
+	int GetCapacity() { return mSlabs.size() * mSlabSize; }
+	int GetFreeCount() { return mFree.size(); }
+
+private:
+	void AddSlab()
+	{
+		char* lSlab = static_cast<char*>(::operator new(sizeof(T) * mSlabSize));
+		mSlabs.push_back(lSlab);
+
+		mFree.reserve(mFree.size() + mSlabSize);
+		//pushed backwards so the slab is handed out in memory order
+		for (int i = mSlabSize - 1; i >= 0; --i)
+		{
+			mFree.push_back(lSlab + i * sizeof(T));
+		}
+	}
+
+	int mSlabSize;
+	std::vector<void*> mSlabs;
+	std::vector<void*> mFree;
+};
+
+#endif // !OBJECT_POOL__H
@@ -11,8 +11,12 @@ bool FileExists(const std::string& name);
 
 std::string GetDirectoryFromPath(std::string aPath);
 
+//fills the list with the paths, relative to the working directory, of every file with that extension
 void GetAllExtensionPathRecursive(const char* path, const char* extension, std::list<std::string>& listToFill);
 
+//returns the path in lower case with '/' separators and without "." or resolvable ".." folders, used to compare paths
+std::string NormalizePath(const char* aPath);
+
 template<class T>
 static inline std::type_index GetTypeIndex()
 {
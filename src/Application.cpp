@@ -144,10 +144,50 @@ bool Application::Init()
 
 bool Application::Loop() 
 {
-	dt = update_timer.Read();
+	float frame_ms = update_timer.Read();
 	update_timer.Reset();
 
 	bool ret = true;
+
+	//input is read before the steps so the first one already sees it
+	for (std::list<Part*>::iterator it = parts.begin(); it != parts.end(); it++)
+	{
+		if ((*it)->mPartFuncts->active)
+		{
+			if (!(*it)->mPartFuncts->PreLoop())
+			{
+				ret = false;
+			}
+		}
+	}
+
+	//a slow frame can't ask for more steps than the clamp, the rest of the time is not simulated
+	float step_ms = 1000 / fixed_step_hz;
+	accumulated_ms += min(frame_ms, step_ms * max_fixed_steps);
+
+	//dt is kept relative to a frame at the base fps
+	float fixed_dt = BASEFPS / fixed_step_hz;
+	int steps = 0;
+	in_fixed_step = true;
+	while (accumulated_ms >= step_ms && steps < max_fixed_steps)
+	{
+		for (std::list<Part*>::iterator it = parts.begin(); it != parts.end(); it++)
+		{
+			if ((*it)->mPartFuncts->active)
+			{
+				if (!(*it)->mPartFuncts->FixedLoop(fixed_dt))
+				{
+					ret = false;
+				}
+			}
+		}
+		accumulated_ms -= step_ms;
+		++steps;
+	}
+	in_fixed_step = false;
+	interpolation_alpha = accumulated_ms / step_ms;
+
+	dt = frame_ms / (1000.0f / BASEFPS);
 	for (std::list<Part*>::iterator it = parts.begin(); it != parts.end(); it++)
 	{
 		if ((*it)->mPartFuncts->active)
@@ -159,10 +199,9 @@ bool Application::Loop()
 		}
 	}
 	
-	float ms_of_frame = (1 / fps_cap) * 1000;
-
 	if (fps_cap != 0)
 	{
+		float ms_of_frame = (1 / fps_cap) * 1000;
 		float time_left_of_the_frame = ms_of_frame - update_timer.Read();
 		if (time_left_of_the_frame > 0)
 		{
@@ -170,8 +209,6 @@ bool Application::Loop()
 		}
 	}
 
-	float base_ms_on_frame = (1000 / 60);
-	dt =1/( base_ms_on_frame/ms_of_frame);
 	return ret;
 };
 
@@ -209,6 +246,12 @@ void Application::LoadConfig(const char* filename)
 		Logger::Console_log(LogLevel::LOG_WARN,"creating new configuration file...");
 
 		config_node = config_file.append_child("config");
+
+		pugi::xml_node app_node = config_node.append_child("Application");
+		app_node.append_attribute("fps_cap") = fps_cap;
+		app_node.append_attribute("fixed_step_hz") = DEFAULT_FIXED_STEP_HZ;
+		app_node.append_attribute("max_fixed_steps") = DEFAULT_MAX_FIXED_STEPS;
+
 		for (std::list<Part*>::iterator it = parts.begin(); it != parts.end(); it++)
 		{
 			pugi::xml_node part_node = config_node.append_child((*it)->name.c_str());
@@ -224,6 +267,20 @@ void Application::LoadConfig(const char* filename)
 		config_node = config_file.child("config");
 	}
 
+	pugi::xml_node app_node = config_node.child("Application");
+	fps_cap = app_node.attribute("fps_cap").as_float(fps_cap);
+	fixed_step_hz = app_node.attribute("fixed_step_hz").as_float(DEFAULT_FIXED_STEP_HZ);
+	max_fixed_steps = app_node.attribute("max_fixed_steps").as_int(DEFAULT_MAX_FIXED_STEPS);
+	if (fixed_step_hz <= 0)
+	{
+		Logger::Console_log(LogLevel::LOG_WARN, "fixed_step_hz must be positive, using the default");
+		fixed_step_hz = DEFAULT_FIXED_STEP_HZ;
+	}
+	if (max_fixed_steps < 1)
+	{
+		max_fixed_steps = 1;
+	}
+
 	for (std::list<Part*>::iterator it = parts.begin(); it != parts.end(); it++)
 	{
 			pugi::xml_node part_node = config_node.child((*it)->name.c_str());
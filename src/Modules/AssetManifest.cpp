@@ -0,0 +1,180 @@
+#include "RXpch.h"
+#include "AssetManifest.h"
+#include "Utils/Logger.h"
+#include "Utils/Utils.h"
+#include "pugiXML/src/pugixml.hpp"
+
+static const char* sAssetTypeNames[ASSET_UNKNOWN] = { "texture", "music", "sfx" };
+
+//reads the size from the header of a png without decoding it
+static bool ReadPNGSize(const std::vector<char>& aData, int& aWidth, int& aHeight)
+{
+	static const unsigned char lSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (aData.size() < 24 || memcmp(aData.data(), lSignature, 8) != 0)
+	{
+		return false;
+	}
+
+	const unsigned char* lIHDR = (const unsigned char*)aData.data() + 16;
+	aWidth = (lIHDR[0] << 24) | (lIHDR[1] << 16) | (lIHDR[2] << 8) | lIHDR[3];
+	aHeight = (lIHDR[4] << 24) | (lIHDR[5] << 16) | (lIHDR[6] << 8) | lIHDR[7];
+	return true;
+}
+
+AssetManifest& AssetManifest::Get()
+{
+	static AssetManifest sManifest;
+	static bool sLoaded = false;
+
+	if (!sLoaded)
+	{
+		sLoaded = true;
+		if (!sManifest.Load(ASSET_MANIFEST_FILE))
+		{
+			Logger::Console_log(LogLevel::LOG_WARN, "No asset manifest found, generating " ASSET_MANIFEST_FILE "...");
+			sManifest.Generate();
+			sManifest.Save(ASSET_MANIFEST_FILE);
+		}
+	}
+	return sManifest;
+}
+
+const asset_entry* AssetManifest::Find(const char* aPath)
+{
+	std::unordered_map<std::string, asset_entry>::iterator it = mEntries.find(NormalizePath(aPath));
+	if (it == mEntries.end())
+	{
+		return nullptr;
+	}
+	return &it->second;
+}
+
+void AssetManifest::GetAllOfType(AssetType aType, std::vector<const asset_entry*>& aListToFill)
+{
+	for (std::unordered_map<std::string, asset_entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->second.type == aType)
+		{
+			aListToFill.push_back(&it->second);
+		}
+	}
+}
+
+bool AssetManifest::Load(const char* aFile)
+{
+	pugi::xml_document lDocument;
+	pugi::xml_parse_result result = lDocument.load_file(aFile);
+	if (result.status != pugi::xml_parse_status::status_ok)
+	{
+		return false;
+	}
+
+	pugi::xml_node lManifest = lDocument.child("manifest");
+	for (pugi::xml_node lAsset = lManifest.child("asset"); lAsset; lAsset = lAsset.next_sibling("asset"))
+	{
+		asset_entry lEntry;
+		lEntry.path = lAsset.attribute("path").as_string();
+		lEntry.type = ASSET_UNKNOWN;
+
+		std::string lType = lAsset.attribute("type").as_string();
+		for (int i = 0; i < ASSET_UNKNOWN; ++i)
+		{
+			if (lType == sAssetTypeNames[i])
+			{
+				lEntry.type = (AssetType)i;
+			}
+		}
+
+		lEntry.size = lAsset.attribute("size").as_ullong(0);
+		lEntry.hash = strtoull(lAsset.attribute("hash").as_string("0"), NULL, 16);
+		lEntry.width = lAsset.attribute("w").as_int(0);
+		lEntry.height = lAsset.attribute("h").as_int(0);
+
+		mEntries[NormalizePath(lEntry.path.c_str())] = lEntry;
+	}
+
+	std::ostringstream lStr;
+	lStr << "Asset manifest loaded with " << mEntries.size() << " assets";
+	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+	return true;
+}
+
+bool AssetManifest::Save(const char* aFile)
+{
+	pugi::xml_document lDocument;
+	pugi::xml_node lManifest = lDocument.append_child("manifest");
+
+	for (std::unordered_map<std::string, asset_entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		asset_entry& lEntry = it->second;
+		pugi::xml_node lAsset = lManifest.append_child("asset");
+		lAsset.append_attribute("path") = lEntry.path.c_str();
+		lAsset.append_attribute("type") = sAssetTypeNames[lEntry.type];
+		lAsset.append_attribute("size") = lEntry.size;
+
+		char lHash[17];
+		snprintf(lHash, sizeof(lHash), "%016llx", lEntry.hash);
+		lAsset.append_attribute("hash") = lHash;
+
+		if (lEntry.type == ASSET_TEXTURE)
+		{
+			lAsset.append_attribute("w") = lEntry.width;
+			lAsset.append_attribute("h") = lEntry.height;
+		}
+	}
+
+	if (!lDocument.save_file(aFile))
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Could not save the asset manifest");
+		return false;
+	}
+	return true;
+}
+
+void AssetManifest::Generate()
+{
+	mEntries.clear();
+
+	const char* lExtensions[ASSET_UNKNOWN] = { "png", "ogg", "wav" };
+	for (int i = 0; i < ASSET_UNKNOWN; ++i)
+	{
+		std::list<std::string> lFiles;
+		GetAllExtensionPathRecursive("", lExtensions[i], lFiles);
+
+		for (std::list<std::string>::iterator it = lFiles.begin(); it != lFiles.end(); ++it)
+		{
+			AddEntry(*it, (AssetType)i);
+		}
+	}
+}
+
+void AssetManifest::AddEntry(const std::string& aPath, AssetType aType)
+{
+	std::ifstream lFile(aPath, std::ios::binary);
+	if (!lFile.is_open())
+	{
+		return;
+	}
+
+	std::vector<char> lData((std::istreambuf_iterator<char>(lFile)), std::istreambuf_iterator<char>());
+
+	asset_entry lEntry;
+	lEntry.path = aPath;
+	lEntry.type = aType;
+	lEntry.size = lData.size();
+
+	//FNV-1a, only used to tell if the file changed
+	lEntry.hash = 14695981039346656037ull;
+	for (std::vector<char>::iterator it = lData.begin(); it != lData.end(); ++it)
+	{
+		lEntry.hash ^= (unsigned char)(*it);
+		lEntry.hash *= 1099511628211ull;
+	}
+
+	if (aType == ASSET_TEXTURE)
+	{
+		ReadPNGSize(lData, lEntry.width, lEntry.height);
+	}
+
+	mEntries[NormalizePath(aPath.c_str())] = lEntry;
+}
@@ -0,0 +1,54 @@
+#ifndef ASSET_MANIFEST__H
+#define ASSET_MANIFEST__H
+
+#include "PartsDef.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define ASSET_MANIFEST_FILE "asset_manifest.xml"
+
+enum AssetType
+{
+	ASSET_TEXTURE = 0,
+	ASSET_MUSIC,
+	ASSET_SFX,
+
+	ASSET_UNKNOWN
+};
+
+struct asset_entry
+{
+	//path relative to the working directory, as it has to be opened
+	std::string path;
+	AssetType type;
+	uint64 size = 0;
+	uint64 hash = 0;
+	//only known for textures
+	int width = 0;
+	int height = 0;
+};
+
+/*list of every asset the game can load, generated once by scanning the working directory and saved to a file
+modules use it to register assets without opening them, the data is only decoded on first use*/
+class AssetManifest
+{
+public:
+	//loads the manifest file, generating it first if it doesn't exist
+	static AssetManifest& Get();
+
+	//returns the entry for that path, nullptr if the asset is not listed
+	const asset_entry* Find(const char* aPath);
+	void GetAllOfType(AssetType aType, std::vector<const asset_entry*>& aListToFill);
+
+private:
+	bool Load(const char* aFile);
+	bool Save(const char* aFile);
+	void Generate();
+	void AddEntry(const std::string& aPath, AssetType aType);
+
+	//indexed by the normalized path
+	std::unordered_map<std::string, asset_entry> mEntries;
+};
+
+#endif // !ASSET_MANIFEST__H
@@ -2,6 +2,7 @@
 #include "Utils/Logger.h"
 #include "Utils/Utils.h"
 #include "AudioImpl.h"
+#include "AssetManifest.h"
 
 #include "SDL/include/SDL.h"
 #include "SDL_mixer\include\SDL_mixer.h"
@@ -83,21 +84,8 @@ bool Audio::AudioImpl::Init()
 		Mix_Volume(i, real_fx_volume);
 	}
 
-	std::list<std::string> lSongs;
-	GetAllExtensionPathRecursive("", "ogg", lSongs);
-
-	for (std::list<std::string>::iterator it = lSongs.begin(); it != lSongs.end(); it++)
-	{
-		mPartInst->LoadMusic((*it).c_str());
-	}
-
-	std::list<std::string> lSFX;
-	GetAllExtensionPathRecursive("", "wav", lSFX);
-
-	for (std::list<std::string>::iterator it = lSFX.begin(); it != lSFX.end(); it++)
-	{
-		mPartInst->LoadSFX((*it).c_str());
-	}
+	//songs and sfx are loaded the first time they are played
+	AssetManifest::Get();
 
 	return ret;
 }
@@ -106,17 +94,25 @@ bool Audio::AudioImpl::CleanUp()
 {
 	for (std::map<AudioID,SFX*>::iterator it = sfx_list.begin(); it != sfx_list.end(); it++)
 	{
-		Mix_FreeChunk((*it).second->sfx);
+		if ((*it).second->sfx != nullptr)
+		{
+			Mix_FreeChunk((*it).second->sfx);
+		}
 		delete(*it).second;
 	}
 	sfx_list.clear();
+	sfx_paths.clear();
 
 	for (std::map<AudioID,Music*>::iterator it = music_list.begin(); it != music_list.end(); it++)
 	{
-		Mix_FreeMusic((*it).second->music);
+		if ((*it).second->music != nullptr)
+		{
+			Mix_FreeMusic((*it).second->music);
+		}
 		delete(*it).second;
 	}
 	music_list.clear();
+	music_paths.clear();
 
 	Mix_CloseAudio();
 	Mix_Quit();
@@ -125,6 +121,47 @@ bool Audio::AudioImpl::CleanUp()
 	return true;
 }
 
+bool Audio::AudioImpl::MakeResident(Music* aMusic)
+{
+	if (aMusic->music == nullptr && !aMusic->load_failed)
+	{
+		aMusic->music = Mix_LoadMUS(aMusic->path.c_str());
+		if (aMusic->music == NULL)
+		{
+			Logger::Console_log(LogLevel::LOG_ERROR,"Can't load music");
+			aMusic->load_failed = true;
+		}
+	}
+	return aMusic->music != nullptr;
+}
+
+bool Audio::AudioImpl::MakeResident(SFX* aSFX)
+{
+	if (aSFX->sfx == nullptr && !aSFX->load_failed)
+	{
+		aSFX->sfx = Mix_LoadWAV(aSFX->path.c_str());
+		if (aSFX->sfx == NULL)
+		{
+			Logger::Console_log(LogLevel::LOG_ERROR,"Can't load sfx");
+			aSFX->load_failed = true;
+		}
+	}
+	return aSFX->sfx != nullptr;
+}
+
+bool Audio::AudioImpl::AudioFileExists(const char* aFile)
+{
+	if (AssetManifest::Get().Find(aFile) != nullptr || FileExists(aFile))
+	{
+		return true;
+	}
+
+	std::string lStr = "Could not find audio file with path: ";
+	lStr += aFile;
+	Logger::Console_log(LogLevel::LOG_ERROR, lStr.c_str());
+	return false;
+}
+
 #pragma endregion
 
 #pragma region PUBLIC API
@@ -138,28 +175,23 @@ AudioID Audio::LoadMusic(const char * file, float fade,float volume)
 		return 0;
 	}
 
-	for (std::map<AudioID, Music*>::iterator it = lImpl->music_list.begin(); it != lImpl->music_list.end(); it++)
+	std::string lKey = NormalizePath(file);
+	std::unordered_map<std::string, AudioID>::iterator lFound = lImpl->music_paths.find(lKey);
+	if (lFound != lImpl->music_paths.end())
 	{
-		if (std::strcmp((*it).second->path.c_str(), file) == 0)
-		{
-			return (*it).first;
-		}
+		return lFound->second;
 	}
 
-
-	Mix_Music* lMusic= Mix_LoadMUS(file);
-	if (lMusic == NULL)
+	if (!lImpl->AudioFileExists(file))
 	{
-		Logger::Console_log(LogLevel::LOG_ERROR,"Can't load music");
 		return -1;
 	}
-	else
-	{
-		lImpl->mAudioCount++;
-		Music* new_music = new Music(file, lImpl->mAudioCount, lMusic, volume, fade);
-		lImpl->music_list.insert(std::make_pair(lImpl->mAudioCount,new_music));
-		return new_music->id;
-	}
+
+	lImpl->mAudioCount++;
+	Music* new_music = new Music(file, lImpl->mAudioCount, nullptr, volume, fade);
+	lImpl->music_list.insert(std::make_pair(lImpl->mAudioCount,new_music));
+	lImpl->music_paths.insert(std::make_pair(lKey, new_music->id));
+	return new_music->id;
 }
 
 AudioID Audio::LoadSFX(const char * file, float volume)
@@ -171,27 +203,23 @@ AudioID Audio::LoadSFX(const char * file, float volume)
 		return 0;
 	}
 
-	for (std::map<AudioID, SFX*>::iterator it = lImpl->sfx_list.begin(); it != lImpl->sfx_list.end(); it++)
+	std::string lKey = NormalizePath(file);
+	std::unordered_map<std::string, AudioID>::iterator lFound = lImpl->sfx_paths.find(lKey);
+	if (lFound != lImpl->sfx_paths.end())
 	{
-		if (std::strcmp((*it).second->path.c_str(), file) == 0)
-		{
-			return (*it).first;
-		}
+		return lFound->second;
 	}
 
-	Mix_Chunk* lChunk = Mix_LoadWAV(file);
-	if (lChunk == NULL)
+	if (!lImpl->AudioFileExists(file))
 	{
-		Logger::Console_log(LogLevel::LOG_ERROR,"Can't load sfx");
 		return -1;
 	}
-	else
-	{
-		lImpl->mAudioCount++;
-		SFX* new_sfx = new SFX(file, lImpl->mAudioCount, lChunk, volume);
-		lImpl->sfx_list.insert(std::make_pair(lImpl->mAudioCount, new_sfx));
-		return new_sfx->id;
-	}
+
+	lImpl->mAudioCount++;
+	SFX* new_sfx = new SFX(file, lImpl->mAudioCount, nullptr, volume);
+	lImpl->sfx_list.insert(std::make_pair(lImpl->mAudioCount, new_sfx));
+	lImpl->sfx_paths.insert(std::make_pair(lKey, new_sfx->id));
+	return new_sfx->id;
 }
 
 void Audio::PlayMusic(AudioID music_id, float fade_in_ms)
@@ -203,7 +231,13 @@ void Audio::PlayMusic(AudioID music_id, float fade_in_ms)
 		return;
 	}
 
-	Music* music_selected = lImpl->music_list[music_id];
+	std::map<AudioID, Music*>::iterator lFound = lImpl->music_list.find(music_id);
+	if (lFound == lImpl->music_list.end() || !lImpl->MakeResident((*lFound).second))
+	{
+		return;
+	}
+
+	Music* music_selected = (*lFound).second;
 	if (music_id != lImpl->current_song)
 	{
 		lImpl->current_song = music_id;
@@ -234,12 +268,13 @@ uint Audio::PlaySFX(AudioID sfx_id, int repeat, uint channel)
 		return 0;
 	}
 
-	SFX* sfx_selected = lImpl->sfx_list[sfx_id];
-
-	if (sfx_selected == nullptr)
+	std::map<AudioID, SFX*>::iterator lFound = lImpl->sfx_list.find(sfx_id);
+	if (lFound == lImpl->sfx_list.end() || !lImpl->MakeResident((*lFound).second))
 	{
 		return 0;
 	}
+
+	SFX* sfx_selected = (*lFound).second;
 	
 	int chan = channel;
 	if (channel == -1)
@@ -3,12 +3,15 @@
 
 #include "../include/Modules/Audio.h"
 #include "PartImpl.h"
+#include <unordered_map>
 
 struct Music
 {
 	std::string path;
 	uint id;
+	//nullptr until the song is played for the first time
 	_Mix_Music* music;
+	bool load_failed = false;
 	float volume = 1.0f;
 	float fade;
 
@@ -20,7 +23,9 @@ struct SFX
 {
 	std::string path;
 	uint id;
+	//nullptr until the sfx is played for the first time
 	Mix_Chunk* sfx;
+	bool load_failed = false;
 	float volume = 1.0f;
 
 	SFX(const char* aPath, uint aID, Mix_Chunk* aSFX, float aVolume) 
@@ -49,6 +54,9 @@ private:
 	int mAudioCount = 0;
 	std::map<AudioID, Music*> music_list;
 	std::map<AudioID, SFX*> sfx_list;
+	//normalized paths of the registered files
+	std::unordered_map<std::string, AudioID> music_paths;
+	std::unordered_map<std::string, AudioID> sfx_paths;
 	friend class Audio;
 
 	float settings_volume = 100;
@@ -61,6 +69,11 @@ private:
 	AudioID current_song = -1;
 
 	int GetFirstFreeChannel();
+	//loads the file of the audio if it is not in memory yet
+	bool MakeResident(Music* aMusic);
+	bool MakeResident(SFX* aSFX);
+	//checks that the file can be found before registering it
+	bool AudioFileExists(const char* aFile);
 
 	Audio* mPartInst;
 };
@@ -3,6 +3,7 @@
 #include "Modules/Input.h"
 #include "Modules/SceneController.h"
 #include "Modules/Render.h"
+#include "Modules/ObjectManager.h"
 #include "Utils/Logger.h"
 
 #include "CameraImpl.h"
@@ -35,10 +36,23 @@ bool Camera::CameraImpl::Loop(float dt)//camera can't go offbounds
 	screenarea.w = window_w;
 	screenarea.h = window_h;
 	
-	if (target != nullptr)
+	GameObject* lTarget = nullptr;
+	if (target != 0)
 	{
-		position_x = (target->collider.x + target->collider.w / 2) - width / 2;
-		position_y = (target->collider.y + target->collider.h / 2) - height / 2;
+		lTarget = mPartInst->mApp.GetModule<ObjectManager>().GetObjectFromHandle(target);
+		if (lTarget == nullptr)
+		{
+			Logger::Console_log(LogLevel::LOG_WARN, "Camera follow target was deleted");
+			target = 0;
+		}
+	}
+
+	if (lTarget != nullptr)
+	{
+		//follows the object where it is drawn so it doesn't shake between steps
+		RXRect lCollider = mPartInst->mApp.GetModule<ObjectManager>().GetInterpolatedCollider(lTarget);
+		position_x = (lCollider.x + lCollider.w / 2) - width / 2;
+		position_y = (lCollider.y + lCollider.h / 2) - height / 2;
 
 		int room_w, room_h;
 		mPartInst->mApp.GetModule<SceneController>().GetRoomSize(room_w, room_h);
@@ -121,7 +135,12 @@ void Camera::FollowObject(GameObject* new_target)
 	{
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 	}
-	lImpl->target = new_target;
+	lImpl->target = new_target != nullptr ? new_target->GetHandle() : 0;
+	if (new_target != nullptr && lImpl->target == 0)
+	{
+		Logger::Console_log(LogLevel::LOG_WARN, "Camera can't follow an object that was not added to the ObjectManager");
+		return;
+	}
 	Logger::Console_log(LogLevel::LOG_INFO,"New camera follow target!");
 }
 
@@ -263,4 +282,22 @@ RXRect Camera::GetScreenArea()
 	return lImpl->screenarea;
 }
 
+RXRect Camera::GetWorldArea()
+{
+	CameraImpl* lImpl = dynamic_cast<CameraImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+	}
+
+	//the screen area is scaled by the window, objects and tiles are not
+	float lScale = mApp.GetModule<Window>().GetScale();
+	RXRect lArea = lImpl->screenarea;
+	lArea.x = (int)floorf(lArea.x / lScale);
+	lArea.y = (int)floorf(lArea.y / lScale);
+	lArea.w = (int)ceilf(lArea.w / lScale);
+	lArea.h = (int)ceilf(lArea.h / lScale);
+	return lArea;
+}
+
 #pragma endregion
\ No newline at end of file
@@ -46,7 +46,8 @@ private:
 
 	int alpha = 0;
 
-	GameObject* target = nullptr;
+	//resolved every frame so a deleted target is never read
+	ObjectHandle target = 0;
 };
 
 #endif
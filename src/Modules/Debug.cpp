@@ -3,6 +3,7 @@
 #include "Modules/Render.h"
 #include "Modules/Input.h"
 #include "Modules/Debug.h"
+#include "Modules/Textures.h"
 #include "Utils/Utils.h"
 #include <Psapi.h>
 
@@ -100,6 +101,12 @@ bool Debug::DebugImpl::Loop(float dt)
 		lString = "Total Objects: ";
 		lString += std::to_string(mPartInst->mApp.GetModule<ObjectManager>().GetTotalObjectNumber());
 		mPartInst->mApp.GetModule<Render>().RenderText(lString.c_str(), mPartInst->mDebugPanelFont, 10, 145, 0, { 255,255,255,255 }, RenderQueue::RENDER_DEBUG, true);
+
+		lString = "Texture MB: ";
+		lString += std::to_string(mPartInst->mApp.GetModule<Textures>().Get_Texture_Memory_Usage() / (1024 * 1024));
+		lString += " Evictions: ";
+		lString += std::to_string(mPartInst->mApp.GetModule<Textures>().Get_Texture_Evictions());
+		mPartInst->mApp.GetModule<Render>().RenderText(lString.c_str(), mPartInst->mDebugPanelFont, 10, 170, 0, { 255,255,255,255 }, RenderQueue::RENDER_DEBUG, true);
 	}
 
 	if (mIsDebugSceneActive)
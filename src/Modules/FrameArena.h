@@ -0,0 +1,103 @@
+#ifndef FRAME_ARENA__H
+#define FRAME_ARENA__H
+
+#include <vector>
+#include <new>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#define FRAME_ARENA_BLOCK_SIZE (1024 * 1024)
+
+/*linear allocator that is reset once per frame
+memory blocks are kept between frames, so once the arena has grown to the size of a frame no more heap allocations happen
+only trivially destructible types can be allocated since nothing is destroyed on reset*/
+class FrameArena
+{
+public:
+	FrameArena(size_t aBlockSize = FRAME_ARENA_BLOCK_SIZE) : mBlockSize(aBlockSize) {};
+
+	~FrameArena()
+	{
+		for (std::vector<Block>::iterator it = mBlocks.begin(); it != mBlocks.end(); ++it)
+		{
+			delete[] (*it).memory;
+		}
+		mBlocks.clear();
+	}
+
+	//returns aSize bytes aligned to aAlign, valid until the next Reset
+	void* Allocate(size_t aSize, size_t aAlign)
+	{
+		while (mCurrentBlock < mBlocks.size())
+		{
+			Block& lBlock = mBlocks[mCurrentBlock];
+			size_t lStart = (lBlock.used + aAlign - 1) & ~(aAlign - 1);
+			if (lStart + aSize <= lBlock.size)
+			{
+				lBlock.used = lStart + aSize;
+				return lBlock.memory + lStart;
+			}
+			++mCurrentBlock;
+		}
+
+		//out of space, grow with a new block big enough for this request
+		Block lNewBlock;
+		lNewBlock.size = (aSize + aAlign > mBlockSize) ? aSize + aAlign : mBlockSize;
+		lNewBlock.memory = new char[lNewBlock.size];
+		lNewBlock.used = 0;
+		mBlocks.push_back(lNewBlock);
+		mCurrentBlock = mBlocks.size() - 1;
+
+		return Allocate(aSize, aAlign);
+	}
+
+	//constructs an object inside of the arena
+	template<class T, class... Args>
+	T* New(Args&&... aArgs)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "FrameArena can only hold trivially destructible types");
+		return new(Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(aArgs)...);
+	}
+
+	//allocates an uninitialized array inside of the arena
+	template<class T>
+	T* NewArray(size_t aAmount)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "FrameArena can only hold trivially destructible types");
+		return (T*)Allocate(sizeof(T) * aAmount, alignof(T));
+	}
+
+	//copies a null terminated string inside of the arena
+	const char* CopyString(const char* aString)
+	{
+		size_t lLength = strlen(aString);
+		char* lResult = NewArray<char>(lLength + 1);
+		memcpy(lResult, aString, lLength + 1);
+		return lResult;
+	}
+
+	//invalidates everything allocated so far, keeps the memory for the next frame
+	void Reset()
+	{
+		for (std::vector<Block>::iterator it = mBlocks.begin(); it != mBlocks.end(); ++it)
+		{
+			(*it).used = 0;
+		}
+		mCurrentBlock = 0;
+	}
+
+private:
+	struct Block
+	{
+		char* memory;
+		size_t size;
+		size_t used;
+	};
+
+	std::vector<Block> mBlocks;
+	size_t mCurrentBlock = 0;
+	size_t mBlockSize;
+};
+
+#endif // !FRAME_ARENA__H
@@ -0,0 +1,142 @@
+#include "RXpch.h"
+#include "ImageDecodePool.h"
+#include "Utils/Logger.h"
+
+#include "SDL_image/include/SDL_image.h"
+
+void ImageDecodePool::Start(int aThreads)
+{
+	if (!mWorkers.empty())
+	{
+		return;
+	}
+
+	if (aThreads <= 0)
+	{
+		//the main thread keeps a core for itself
+		aThreads = (int)std::thread::hardware_concurrency() - 1;
+		if (aThreads < 1)
+		{
+			aThreads = 1;
+		}
+	}
+
+	mStopping = false;
+	for (int i = 0; i < aThreads; ++i)
+	{
+		mWorkers.push_back(std::thread(&ImageDecodePool::WorkerLoop, this));
+	}
+
+	std::ostringstream lStr;
+	lStr << "Image decoding pool started with " << aThreads << " threads";
+	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+}
+
+void ImageDecodePool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lLock(mMutex);
+		mStopping = true;
+	}
+	mJobQueued.notify_all();
+
+	for (std::vector<std::thread>::iterator it = mWorkers.begin(); it != mWorkers.end(); ++it)
+	{
+		(*it).join();
+	}
+	mWorkers.clear();
+
+	while (!mQueued.empty())
+	{
+		mQueued.pop();
+	}
+	while (!mFinished.empty())
+	{
+		if (mFinished.front().surface != nullptr)
+		{
+			SDL_FreeSurface(mFinished.front().surface);
+		}
+		mFinished.pop();
+	}
+	mDecoding = 0;
+}
+
+void ImageDecodePool::Push(unsigned int aID, const char* aPath)
+{
+	decode_job lJob;
+	lJob.id = aID;
+	lJob.path = aPath;
+
+	{
+		std::lock_guard<std::mutex> lLock(mMutex);
+		mQueued.push(lJob);
+	}
+	mJobQueued.notify_one();
+}
+
+bool ImageDecodePool::PopFinished(decode_job& aJob)
+{
+	std::lock_guard<std::mutex> lLock(mMutex);
+	if (mFinished.empty())
+	{
+		return false;
+	}
+
+	aJob = mFinished.front();
+	mFinished.pop();
+	return true;
+}
+
+bool ImageDecodePool::WaitFinished(decode_job& aJob)
+{
+	std::unique_lock<std::mutex> lLock(mMutex);
+	mJobFinished.wait(lLock, [this]() { return !mFinished.empty() || (mQueued.empty() && mDecoding == 0) || mWorkers.empty(); });
+	if (mFinished.empty())
+	{
+		return false;
+	}
+
+	aJob = mFinished.front();
+	mFinished.pop();
+	return true;
+}
+
+int ImageDecodePool::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lLock(mMutex);
+	return mQueued.size() + mDecoding;
+}
+
+void ImageDecodePool::WorkerLoop()
+{
+	while (true)
+	{
+		decode_job lJob;
+		{
+			std::unique_lock<std::mutex> lLock(mMutex);
+			mJobQueued.wait(lLock, [this]() { return mStopping || !mQueued.empty(); });
+			if (mStopping)
+			{
+				return;
+			}
+
+			lJob = mQueued.front();
+			mQueued.pop();
+			mDecoding++;
+		}
+
+		lJob.surface = IMG_Load(lJob.path.c_str());
+		if (lJob.surface == NULL)
+		{
+			//the logger is not thread safe, the main thread reports it
+			lJob.error = IMG_GetError();
+		}
+
+		{
+			std::lock_guard<std::mutex> lLock(mMutex);
+			mDecoding--;
+			mFinished.push(lJob);
+		}
+		mJobFinished.notify_all();
+	}
+}
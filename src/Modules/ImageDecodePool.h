@@ -0,0 +1,64 @@
+#ifndef IMAGE_DECODE_POOL__H
+#define IMAGE_DECODE_POOL__H
+
+#include <vector>
+#include <queue>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct SDL_Surface;
+
+#define DECODE_POOL_DEFAULT_THREADS 0
+#define DECODE_POOL_DEFAULT_UPLOAD_BUDGET 2.0f
+
+struct decode_job
+{
+	//id of the texture the image belongs to, it can be stale once the job is finished
+	unsigned int id;
+	std::string path;
+	//nullptr if the image could not be decoded
+	SDL_Surface* surface = nullptr;
+	std::string error;
+};
+
+/*worker threads that decode images into surfaces
+the surfaces are collected by the main thread, that is the only one allowed to create textures*/
+class ImageDecodePool
+{
+public:
+	~ImageDecodePool() { Stop(); }
+
+	//starts the workers, 0 threads uses one less than the number of cores
+	void Start(int aThreads);
+	//waits for the workers to finish and frees the surfaces nobody collected
+	void Stop();
+
+	void Push(unsigned int aID, const char* aPath);
+	//takes a finished job, returns false if there is none
+	bool PopFinished(decode_job& aJob);
+	//blocks until a job is finished, returns false if there are no jobs left
+	bool WaitFinished(decode_job& aJob);
+
+	//jobs queued or being decoded
+	int GetPendingCount();
+	int GetThreadCount() { return mWorkers.size(); }
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> mWorkers;
+	std::queue<decode_job> mQueued;
+	std::queue<decode_job> mFinished;
+	int mDecoding = 0;
+	bool mStopping = false;
+
+	std::mutex mMutex;
+	//signaled when a job is queued or the pool stops
+	std::condition_variable mJobQueued;
+	//signaled when a job is finished
+	std::condition_variable mJobFinished;
+};
+
+#endif // !IMAGE_DECODE_POOL__H
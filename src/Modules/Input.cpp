@@ -2,6 +2,7 @@
 #include "Modules/Input.h"
 #include "Utils/Logger.h"
 #include "InputImpl.h"
+#include "EngineAPI.h"
 #include "SDL\include\SDL.h"
 
 Input::Input(EngineAPI& aAPI): Part("Input",aAPI)
@@ -11,6 +12,40 @@ Input::Input(EngineAPI& aAPI): Part("Input",aAPI)
 
 #pragma region IMPLEMENTATION
 
+#define INPUT_EDGE_DOWN 1
+#define INPUT_EDGE_RELEASE 2
+
+static void LatchEdge(Keystate aState, Uint8& aEdges)
+{
+	if (aState == KEY_DOWN)
+		aEdges |= INPUT_EDGE_DOWN;
+	else if (aState == KEY_RELEASE)
+		aEdges |= INPUT_EDGE_RELEASE;
+}
+
+//returns the oldest edge still waiting, the key held now tells which of both came first
+static Keystate ConsumeEdge(bool aHeld, Uint8& aEdges)
+{
+	Uint8 lFirst = aHeld ? INPUT_EDGE_RELEASE : INPUT_EDGE_DOWN;
+	Uint8 lEdge = (aEdges & lFirst) ? lFirst : (aEdges & ~lFirst);
+	aEdges &= ~lEdge;
+
+	if (lEdge == INPUT_EDGE_DOWN)
+		return KEY_DOWN;
+	if (lEdge == INPUT_EDGE_RELEASE)
+		return KEY_RELEASE;
+	return aHeld ? KEY_REPEAT : KEY_IDLE;
+}
+
+static void ConsumeTriggerEdge(const trigger& aTrigger, Uint8& aEdges, trigger& aFixed)
+{
+	Keystate lState = ConsumeEdge(aTrigger.is_down, aEdges);
+	aFixed.axis = aTrigger.axis;
+	aFixed.is_down = aTrigger.is_down;
+	aFixed.is_pressed = lState == KEY_DOWN;
+	aFixed.is_released = lState == KEY_RELEASE;
+}
+
 bool Input::InputImpl::Init()
 {
 	bool ret = true;
@@ -20,6 +55,18 @@ bool Input::InputImpl::Init()
 	controller = new Keystate[NUMBER_OF_BUTTONS];
 	memset(controller, BUTTON_IDLE, sizeof(Keystate) * NUMBER_OF_BUTTONS);
 
+	fixed_keyboard = new Keystate[MAX_KEYS];
+	memset(fixed_keyboard, KEY_IDLE, sizeof(Keystate) * MAX_KEYS);
+	fixed_controller = new Keystate[NUMBER_OF_BUTTONS];
+	memset(fixed_controller, BUTTON_IDLE, sizeof(Keystate) * NUMBER_OF_BUTTONS);
+	fixed_left_trigger = trigger();
+	fixed_right_trigger = trigger();
+
+	keyboard_edges = new Uint8[MAX_KEYS];
+	memset(keyboard_edges, 0, MAX_KEYS);
+	controller_edges = new Uint8[NUMBER_OF_BUTTONS];
+	memset(controller_edges, 0, NUMBER_OF_BUTTONS);
+
 	left_joystick = new joystick();
 	right_joystick = new joystick();
 
@@ -56,7 +103,7 @@ bool Input::InputImpl::Init()
 	return ret;
 
 }
-bool Input::InputImpl::Loop(float dt)
+bool Input::InputImpl::PreLoop()
 {
 	bool ret = true;
 
@@ -80,6 +127,7 @@ bool Input::InputImpl::Loop(float dt)
 			else
 				keyboard[i] = KEY_IDLE;
 		}
+		LatchEdge(keyboard[i], keyboard_edges[i]);
 	}
 	//controller stuff
 	if (controller_active)
@@ -107,6 +155,7 @@ bool Input::InputImpl::Loop(float dt)
 				else
 					controller[i] = KEY_IDLE;
 			}
+			LatchEdge(controller[i], controller_edges[i]);
 		}
 
 		float leftxpast = left_joystick->x_axis;
@@ -212,6 +261,9 @@ bool Input::InputImpl::Loop(float dt)
 			}
 		}
 
+		LatchEdge(left_trigger->is_pressed ? KEY_DOWN : (left_trigger->is_released ? KEY_RELEASE : KEY_IDLE), left_trigger_edges);
+		LatchEdge(right_trigger->is_pressed ? KEY_DOWN : (right_trigger->is_released ? KEY_RELEASE : KEY_IDLE), right_trigger_edges);
+
 		
 	}
 	while (SDL_PollEvent(&event) != 0)
@@ -268,10 +320,49 @@ bool Input::InputImpl::Loop(float dt)
 	return ret;
 }
 
+bool Input::InputImpl::FixedLoop(float dt)
+{
+	for (int i = 0; i < MAX_KEYS; ++i)
+	{
+		fixed_keyboard[i] = ConsumeEdge(keyboard[i] == KEY_DOWN || keyboard[i] == KEY_REPEAT, keyboard_edges[i]);
+	}
+	for (int i = 0; i < NUMBER_OF_BUTTONS; ++i)
+	{
+		fixed_controller[i] = ConsumeEdge(controller[i] == KEY_DOWN || controller[i] == KEY_REPEAT, controller_edges[i]);
+	}
+	ConsumeTriggerEdge(*left_trigger, left_trigger_edges, fixed_left_trigger);
+	ConsumeTriggerEdge(*right_trigger, right_trigger_edges, fixed_right_trigger);
+
+	return true;
+}
+
+Keystate* Input::InputImpl::GetKeyboard()
+{
+	return mPartInst->mApp.IsInFixedStep() ? fixed_keyboard : keyboard;
+}
+
+Keystate* Input::InputImpl::GetController()
+{
+	return mPartInst->mApp.IsInFixedStep() ? fixed_controller : controller;
+}
+
+trigger* Input::InputImpl::GetTriggerState(bool aLeft)
+{
+	if (mPartInst->mApp.IsInFixedStep())
+	{
+		return aLeft ? &fixed_left_trigger : &fixed_right_trigger;
+	}
+	return aLeft ? left_trigger : right_trigger;
+}
+
 bool Input::InputImpl::CleanUp()
 {
 	bool ret = true;
 	delete[] keyboard;
+	delete[] fixed_keyboard;
+	delete[] fixed_controller;
+	delete[] keyboard_edges;
+	delete[] controller_edges;
 	SDL_QuitSubSystem(SDL_INIT_EVENTS);
 	SDL_QuitSubSystem(SDL_INIT_GAMECONTROLLER);
 	if (controller_active)
@@ -420,14 +511,7 @@ float Input::GetTrigger(bool left)
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 	}
 
-	if (left)
-	{
-		return lImpl->left_trigger->axis;
-	}
-	else
-	{
-		return lImpl->right_trigger->axis;
-	}
+	return lImpl->GetTriggerState(left)->axis;
 }
 bool Input::GetTriggerPressed(bool left)
 {
@@ -437,14 +521,7 @@ bool Input::GetTriggerPressed(bool left)
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 	}
 
-	if (left)
-	{
-		return lImpl->left_trigger->is_pressed;
-	}
-	else
-	{
-		return lImpl->right_trigger->is_pressed;
-	}
+	return lImpl->GetTriggerState(left)->is_pressed;
 }
 
 bool Input::GetTriggerDown(bool left)
@@ -455,14 +532,7 @@ bool Input::GetTriggerDown(bool left)
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 	}
 
-	if (left)
-	{
-		return lImpl->left_trigger->is_down;
-	}
-	else
-	{
-		return lImpl->right_trigger->is_down;
-	}
+	return lImpl->GetTriggerState(left)->is_down;
 }
 
 bool Input::GetTriggerReleased(bool left)
@@ -473,14 +543,7 @@ bool Input::GetTriggerReleased(bool left)
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 	}
 
-	if (left)
-	{
-		return lImpl->left_trigger->is_released;
-	}
-	else
-	{
-		return lImpl->right_trigger->is_released;
-	}
+	return lImpl->GetTriggerState(left)->is_released;
 }
 
 Keystate Input::GetInput(Gameplay_buttons id)
@@ -513,7 +576,7 @@ Keystate Input::GetButton(int id)
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 	}
 
-	return lImpl->controller[id]; 
+	return lImpl->GetController()[id];
 };
 
 Keystate Input::GetKey(int id)
@@ -524,7 +587,7 @@ Keystate Input::GetKey(int id)
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 	}
 
-	return lImpl->keyboard[id];
+	return lImpl->GetKeyboard()[id];
 };
 
 
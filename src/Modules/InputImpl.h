@@ -15,9 +15,17 @@ public:
 		mPartInst = aInput;
 	}
 
+	//the state of the frame, or the latched one while a fixed step runs
+	Keystate* GetKeyboard();
+	Keystate* GetController();
+	trigger* GetTriggerState(bool aLeft);
+
 protected:
 	bool Init();
-	bool Loop(float dt);
+	//pumps the events and reads the devices, once per frame before the fixed steps
+	bool PreLoop();
+	//gives the next fixed step the presses and releases no step has seen yet
+	bool FixedLoop(float dt);
 	bool CleanUp();
 
 	bool LoadConfig(pugi::xml_node& config_node);
@@ -33,6 +41,17 @@ private:
 	trigger* left_trigger;
 	trigger* right_trigger;
 
+	//what the fixed steps see, every press and release reaches exactly one step
+	Keystate* fixed_keyboard;
+	Keystate* fixed_controller;
+	trigger fixed_left_trigger;
+	trigger fixed_right_trigger;
+	//presses and releases waiting for a fixed step
+	Uint8* keyboard_edges;
+	Uint8* controller_edges;
+	Uint8 left_trigger_edges = 0;
+	Uint8 right_trigger_edges = 0;
+
 	SDL_GameController* SDLcontroller = nullptr;
 	int controller_id = 0;
 	bool controller_active = false;
@@ -0,0 +1,157 @@
+#include "RXpch.h"
+#include "JobSystem.h"
+#include "Utils/Logger.h"
+
+void JobSystem::Start(int aThreads)
+{
+	if (!mThreads.empty())
+	{
+		return;
+	}
+
+	if (aThreads <= 0)
+	{
+		//the calling thread works as one more worker
+		aThreads = (int)std::thread::hardware_concurrency() - 1;
+		if (aThreads < 1)
+		{
+			aThreads = 1;
+		}
+	}
+
+	mStopping = false;
+	mPendingJobs = 0;
+	mQueues.clear();
+	for (int i = 0; i <= aThreads; ++i)
+	{
+		mQueues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+	}
+	for (int i = 0; i < aThreads; ++i)
+	{
+		mThreads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+
+	std::ostringstream lStr;
+	lStr << "Job system started with " << aThreads << " threads";
+	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+}
+
+void JobSystem::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lLock(mWakeMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+
+	for (std::vector<std::thread>::iterator it = mThreads.begin(); it != mThreads.end(); ++it)
+	{
+		(*it).join();
+	}
+	mThreads.clear();
+	mQueues.clear();
+}
+
+void JobSystem::ParallelFor(unsigned int aCount, unsigned int aChunkSize, const job_function& aFunction)
+{
+	if (aCount == 0)
+	{
+		return;
+	}
+	if (aChunkSize == 0)
+	{
+		aChunkSize = JOB_SYSTEM_DEFAULT_CHUNK_SIZE;
+	}
+
+	//without workers, or with a single chunk, there is nothing to share
+	if (mThreads.empty() || aCount <= aChunkSize)
+	{
+		aFunction(0, aCount, mThreads.size());
+		return;
+	}
+
+	//workers still awake from the last loop can take a chunk as soon as it is queued
+	mFunction = &aFunction;
+	mPendingJobs = (aCount + aChunkSize - 1) / aChunkSize;
+
+	//chunks are dealt in turns so every worker starts with a similar amount
+	unsigned int lChunks = 0;
+	for (unsigned int lBegin = 0; lBegin < aCount; lBegin += aChunkSize, ++lChunks)
+	{
+		job_range lJob = { lBegin, min(lBegin + aChunkSize, aCount) };
+		worker_queue& lQueue = *mQueues[lChunks % mQueues.size()];
+		std::lock_guard<std::mutex> lLock(lQueue.mutex);
+		lQueue.jobs.push_back(lJob);
+	}
+
+	{
+		std::lock_guard<std::mutex> lLock(mWakeMutex);
+		++mBatch;
+	}
+	mWake.notify_all();
+
+	//the calling thread uses the last queue
+	RunJobs(mThreads.size());
+
+	while (mPendingJobs.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+	mFunction = nullptr;
+}
+
+bool JobSystem::PopJob(unsigned int aWorker, job_range& aJob)
+{
+	{
+		worker_queue& lOwn = *mQueues[aWorker];
+		std::lock_guard<std::mutex> lLock(lOwn.mutex);
+		if (!lOwn.jobs.empty())
+		{
+			aJob = lOwn.jobs.front();
+			lOwn.jobs.pop_front();
+			return true;
+		}
+	}
+
+	for (unsigned int i = 1; i < mQueues.size(); ++i)
+	{
+		worker_queue& lOther = *mQueues[(aWorker + i) % mQueues.size()];
+		std::lock_guard<std::mutex> lLock(lOther.mutex);
+		if (!lOther.jobs.empty())
+		{
+			aJob = lOther.jobs.back();
+			lOther.jobs.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::RunJobs(unsigned int aWorker)
+{
+	job_range lJob;
+	while (PopJob(aWorker, lJob))
+	{
+		(*mFunction)(lJob.begin, lJob.end, aWorker);
+		--mPendingJobs;
+	}
+}
+
+void JobSystem::WorkerLoop(unsigned int aWorker)
+{
+	unsigned int lLastBatch = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lLock(mWakeMutex);
+			mWake.wait(lLock, [this, lLastBatch]() { return mStopping || mBatch != lLastBatch; });
+			if (mStopping)
+			{
+				return;
+			}
+			lLastBatch = mBatch;
+		}
+
+		RunJobs(aWorker);
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef JOB_SYSTEM__H
+#define JOB_SYSTEM__H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+#define JOB_SYSTEM_DEFAULT_THREADS 0
+#define JOB_SYSTEM_DEFAULT_CHUNK_SIZE 256
+
+//function that processes the items from begin to end, worker is the index of the thread running it
+typedef std::function<void(unsigned int aBegin, unsigned int aEnd, unsigned int aWorker)> job_function;
+
+/*pool of threads that split loops in chunks
+every worker has its own queue of chunks and takes work from the others when it runs out*/
+class JobSystem
+{
+public:
+	~JobSystem() { Stop(); }
+
+	//starts the workers, 0 threads uses one less than the number of cores
+	void Start(int aThreads);
+	void Stop();
+
+	//runs the function over [0, aCount) in chunks of aChunkSize and returns once every chunk is done, the calling thread helps too
+	void ParallelFor(unsigned int aCount, unsigned int aChunkSize, const job_function& aFunction);
+
+	//threads that can run chunks, the calling thread included, worker indices go from 0 to this minus 1
+	unsigned int GetWorkerCount() { return mThreads.size() + 1; }
+
+private:
+	struct job_range
+	{
+		unsigned int begin;
+		unsigned int end;
+	};
+
+	struct worker_queue
+	{
+		std::mutex mutex;
+		std::deque<job_range> jobs;
+	};
+
+	//takes a chunk from the worker's own queue or steals one from the back of another
+	bool PopJob(unsigned int aWorker, job_range& aJob);
+	void RunJobs(unsigned int aWorker);
+	void WorkerLoop(unsigned int aWorker);
+
+	std::vector<std::thread> mThreads;
+	std::vector<std::unique_ptr<worker_queue>> mQueues;
+
+	const job_function* mFunction = nullptr;
+	std::atomic<unsigned int> mPendingJobs;
+
+	std::mutex mWakeMutex;
+	std::condition_variable mWake;
+	//increased every time there is a new loop to run
+	unsigned int mBatch = 0;
+	bool mStopping = false;
+};
+
+#endif // !JOB_SYSTEM__H
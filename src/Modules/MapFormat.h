@@ -0,0 +1,113 @@
+#ifndef MAP_FORMAT__H
+#define MAP_FORMAT__H
+
+#include <cstdint>
+
+/*layout of the compiled maps written by the MapCompiler tool
+every section is an array of records at an offset from the start of the file, offsets are multiples of 4
+strings are offsets into the string table, null terminated, 0 is the empty string
+the file is little endian and is used in place once mapped, so records only hold 32 bit values*/
+
+#define MAP_FILE_MAGIC 0x504D5852 //"RXMP"
+#define MAP_FILE_VERSION 1
+#define MAP_FILE_EXTENSION ".rxmap"
+//value of the empty tiles inside of the layer arrays
+#define MAP_FILE_EMPTY_TILE 0xFFFFFFFF
+
+struct map_file_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t file_size;
+
+	uint32_t tileset_count;
+	uint32_t tilesets_offset;
+	uint32_t layer_count;
+	uint32_t layers_offset;
+	uint32_t background_count;
+	uint32_t backgrounds_offset;
+	uint32_t wall_count;
+	uint32_t walls_offset;
+	uint32_t object_count;
+	uint32_t objects_offset;
+	uint32_t property_count;
+	uint32_t properties_offset;
+	uint32_t strings_size;
+	uint32_t strings_offset;
+
+	//properties of the map itself, a range inside of the property records
+	uint32_t map_property_first;
+	uint32_t map_property_count;
+};
+
+struct map_file_tileset
+{
+	int32_t firstgid;
+	int32_t tile_width;
+	int32_t tile_height;
+	int32_t columns;
+	int32_t total_tiles;
+	//image path relative to the map folder
+	uint32_t image;
+};
+
+struct map_file_layer
+{
+	int32_t width;
+	int32_t height;
+	float parallax_x;
+	float parallax_y;
+	int32_t depth;
+	uint32_t tileset;
+	//width * height tile ids, already relative to the tileset, MAP_FILE_EMPTY_TILE if empty
+	uint32_t data_offset;
+};
+
+struct map_file_background
+{
+	uint32_t image;
+	float parallax_x;
+	float parallax_y;
+	int32_t depth;
+	uint32_t repeat_y;
+};
+
+struct map_file_wall
+{
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+};
+
+struct map_file_object
+{
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+	uint32_t type;
+	//range inside of the property records
+	uint32_t property_first;
+	uint32_t property_count;
+};
+
+enum map_property_type
+{
+	MAP_PROPERTY_NONE,
+	MAP_PROPERTY_BOOL,
+	MAP_PROPERTY_FLOAT,
+	MAP_PROPERTY_INT,
+	MAP_PROPERTY_STRING
+};
+
+struct map_file_property
+{
+	uint32_t name;
+	uint32_t type;
+	float num_value;
+	uint32_t bool_value;
+	uint32_t str_value;
+};
+
+#endif // !MAP_FORMAT__H
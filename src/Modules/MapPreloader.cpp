@@ -0,0 +1,96 @@
+#include "RXpch.h"
+#include "MapPreloader.h"
+#include "SceneControllerImpl.h"
+
+void MapPreloader::Start(const map_parse_function& aParse)
+{
+	if (mThread.joinable())
+	{
+		return;
+	}
+
+	mParse = aParse;
+	mStopping = false;
+	mThread = std::thread(&MapPreloader::WorkerLoop, this);
+}
+
+void MapPreloader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lLock(mMutex);
+		mStopping = true;
+	}
+	mMapQueued.notify_all();
+
+	if (mThread.joinable())
+	{
+		mThread.join();
+	}
+
+	mQueued.clear();
+	while (!mFinished.empty())
+	{
+		delete mFinished.front().map;
+		mFinished.pop();
+	}
+}
+
+bool MapPreloader::Push(const char* aPath)
+{
+	{
+		std::lock_guard<std::mutex> lLock(mMutex);
+		if (mParsing == aPath || std::find(mQueued.begin(), mQueued.end(), aPath) != mQueued.end())
+		{
+			return false;
+		}
+		mQueued.push_back(aPath);
+	}
+	mMapQueued.notify_one();
+	return true;
+}
+
+bool MapPreloader::PopFinished(preloaded_map& aMap)
+{
+	std::lock_guard<std::mutex> lLock(mMutex);
+	if (mFinished.empty())
+	{
+		return false;
+	}
+
+	aMap = mFinished.front();
+	mFinished.pop();
+	return true;
+}
+
+void MapPreloader::WorkerLoop()
+{
+	while (true)
+	{
+		preloaded_map lMap;
+		{
+			std::unique_lock<std::mutex> lLock(mMutex);
+			mMapQueued.wait(lLock, [this]() { return mStopping || !mQueued.empty(); });
+			if (mStopping)
+			{
+				return;
+			}
+
+			lMap.path = mQueued.front();
+			mQueued.pop_front();
+			mParsing = lMap.path;
+		}
+
+		lMap.map = new staged_map();
+		if (!mParse(lMap.path.c_str(), *lMap.map) && lMap.map->error == "")
+		{
+			//the logger is not thread safe, the main thread reports it
+			lMap.map->error = "couldn't preload map " + lMap.path;
+		}
+
+		{
+			std::lock_guard<std::mutex> lLock(mMutex);
+			mParsing = "";
+			mFinished.push(lMap);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef MAP_PRELOADER__H
+#define MAP_PRELOADER__H
+
+#include <string>
+#include <deque>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+struct staged_map;
+
+//reads a map into the staged map, it is called from the preloading thread
+typedef std::function<bool(const char* aPath, staged_map& aMap)> map_parse_function;
+
+struct preloaded_map
+{
+	std::string path;
+	//the error of the map is filled if it could not be parsed
+	staged_map* map;
+};
+
+/*thread that parses maps ahead of time so loading them later doesn't have to
+the maps are collected by the main thread, that is the only one allowed to apply them*/
+class MapPreloader
+{
+public:
+	~MapPreloader() { Stop(); }
+
+	void Start(const map_parse_function& aParse);
+	//waits for the thread and frees the maps nobody collected
+	void Stop();
+
+	//returns false if the map was already queued or being parsed
+	bool Push(const char* aPath);
+	//takes a parsed map, returns false if there is none
+	bool PopFinished(preloaded_map& aMap);
+
+private:
+	void WorkerLoop();
+
+	map_parse_function mParse;
+	std::thread mThread;
+	std::deque<std::string> mQueued;
+	std::string mParsing;
+	std::queue<preloaded_map> mFinished;
+	bool mStopping = false;
+
+	std::mutex mMutex;
+	//signaled when a map is queued or the thread stops
+	std::condition_variable mMapQueued;
+};
+
+#endif // !MAP_PRELOADER__H
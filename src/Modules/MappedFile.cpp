@@ -0,0 +1,98 @@
+#include "RXpch.h"
+#include "MappedFile.h"
+
+bool MappedFile::Open(const char* aPath)
+{
+	Close();
+
+	HANDLE lFile = CreateFileA(aPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (lFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER lSize;
+	if (!GetFileSizeEx(lFile, &lSize) || lSize.QuadPart == 0)
+	{
+		CloseHandle(lFile);
+		return false;
+	}
+
+	//write copy lets the engine change tiles in place, the changes never reach the file
+	HANDLE lMapping = CreateFileMappingA(lFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (lMapping == NULL)
+	{
+		CloseHandle(lFile);
+		return false;
+	}
+
+	void* lView = MapViewOfFile(lMapping, FILE_MAP_COPY, 0, 0, 0);
+	if (lView == NULL)
+	{
+		CloseHandle(lMapping);
+		CloseHandle(lFile);
+		return false;
+	}
+
+	mFile = lFile;
+	mMapping = lMapping;
+	mData = (char*)lView;
+	mSize = (size_t)lSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData != nullptr)
+	{
+		UnmapViewOfFile(mData);
+		mData = nullptr;
+	}
+	if (mMapping != nullptr)
+	{
+		CloseHandle((HANDLE)mMapping);
+		mMapping = nullptr;
+	}
+	if (mFile != nullptr)
+	{
+		CloseHandle((HANDLE)mFile);
+		mFile = nullptr;
+	}
+	mSize = 0;
+}
+
+void MappedFile::Swap(MappedFile& aOther)
+{
+	std::swap(mData, aOther.mData);
+	std::swap(mSize, aOther.mSize);
+	std::swap(mFile, aOther.mFile);
+	std::swap(mMapping, aOther.mMapping);
+}
+
+void MappedFile::Prefetch(const char* aData, size_t aSize)
+{
+	static size_t sPageSize = 0;
+	if (sPageSize == 0)
+	{
+		SYSTEM_INFO lInfo;
+		GetSystemInfo(&lInfo);
+		sPageSize = lInfo.dwPageSize;
+	}
+
+	//one read per page is enough to bring it in
+	volatile char lRead = 0;
+	for (size_t i = 0; i < aSize; i += sPageSize)
+	{
+		lRead += aData[i];
+	}
+	if (aSize > 0)
+	{
+		lRead += aData[aSize - 1];
+	}
+}
+
+void MappedFile::Release(const char* aData, size_t aSize)
+{
+	//unlocking pages that are not locked takes them out of the working set, it always reports an error
+	VirtualUnlock((LPVOID)aData, aSize);
+}
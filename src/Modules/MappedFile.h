@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE__H
+#define MAPPED_FILE__H
+
+#include <cstddef>
+
+/*read only file mapped into memory
+the pages are copy on write, they can be changed in memory without touching the file*/
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+
+	//the mapping is owned by a single instance
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* aPath);
+	void Close();
+	//exchanges the mappings, the views stay at the same address
+	void Swap(MappedFile& aOther);
+
+	//reads the pages of a range inside of a mapping so using it later doesn't wait for the disk
+	static void Prefetch(const char* aData, size_t aSize);
+	//lets the system take the pages of a range out of memory, they are read again the next time they are used
+	static void Release(const char* aData, size_t aSize);
+
+	bool IsOpen() { return mData != nullptr; }
+	char* GetData() { return mData; }
+	size_t GetSize() { return mSize; }
+
+private:
+	char* mData = nullptr;
+	size_t mSize = 0;
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+};
+
+#endif // !MAPPED_FILE__H
@@ -3,10 +3,15 @@
 #include "Utils/Logger.h"
 #include "Modules/Debug.h"
 #include "Modules/Render.h"
+#include "Modules/Camera.h"
 #include "EngineElements/GameObject.h"
 
 #include "SDL/include/SDL.h"
 #include "ObjectManagerImpl.h"
+#include "ShapeCast.h"
+
+//set while a worker updates objects in parallel, the calls that change the scene are recorded here instead
+static thread_local object_commands* sCommands = nullptr;
 
 ObjectManager::ObjectManager(EngineAPI& aAPI) : Part("ObjectManager",aAPI)
 {
@@ -15,56 +20,305 @@ ObjectManager::ObjectManager(EngineAPI& aAPI) : Part("ObjectManager",aAPI)
 
 #pragma region IMPLEMENTATION
 
-bool ObjectManager::ObjectManagerImpl::Init()
+bool ObjectManager::ObjectManagerImpl::LoadConfig(pugi::xml_node& config_node)
 {
-	bool ret = true;
+	pugi::xml_node grid_node = config_node.child("collision_grid");
+	mObjectGrid.SetCellSize(grid_node.attribute("cell_size").as_int(SPATIAL_HASH_DEFAULT_CELL_SIZE));
+
+	pugi::xml_node wall_grid_node = config_node.child("wall_grid");
+	mWallGrid.SetCellSize(wall_grid_node.attribute("cell_size").as_int(WALL_GRID_DEFAULT_CELL_SIZE));
 
-	for (int i = 0; i < MAX_WALLS; ++i)
+	pugi::xml_node activation_node = config_node.child("activation");
+	mActivationEnabled = activation_node.attribute("enabled").as_bool(false);
+	mActivationMargin = activation_node.attribute("margin").as_int(ACTIVATION_DEFAULT_MARGIN);
+
+	pugi::xml_node parallel_node = config_node.child("parallel_update");
+	mParallelUpdate = parallel_node.attribute("enabled").as_bool(false);
+	mParallelChunkSize = parallel_node.attribute("chunk_size").as_uint(JOB_SYSTEM_DEFAULT_CHUNK_SIZE);
+	if (mParallelChunkSize == 0)
+	{
+		mParallelChunkSize = JOB_SYSTEM_DEFAULT_CHUNK_SIZE;
+	}
+	if (mParallelUpdate)
 	{
-		walls[i] = nullptr;
+		mJobs.Start(parallel_node.attribute("threads").as_int(JOB_SYSTEM_DEFAULT_THREADS));
 	}
+	return true;
+}
+
+bool ObjectManager::ObjectManagerImpl::CreateConfig(pugi::xml_node& config_node)
+{
+	pugi::xml_node grid_node = config_node.append_child("collision_grid");
+	grid_node.append_attribute("cell_size") = SPATIAL_HASH_DEFAULT_CELL_SIZE;
+
+	pugi::xml_node wall_grid_node = config_node.append_child("wall_grid");
+	wall_grid_node.append_attribute("cell_size") = WALL_GRID_DEFAULT_CELL_SIZE;
+
+	pugi::xml_node activation_node = config_node.append_child("activation");
+	activation_node.append_attribute("enabled") = false;
+	activation_node.append_attribute("margin") = ACTIVATION_DEFAULT_MARGIN;
+
+	pugi::xml_node parallel_node = config_node.append_child("parallel_update");
+	parallel_node.append_attribute("enabled") = false;
+	parallel_node.append_attribute("threads") = JOB_SYSTEM_DEFAULT_THREADS;
+	parallel_node.append_attribute("chunk_size") = JOB_SYSTEM_DEFAULT_CHUNK_SIZE;
+	return true;
+}
+
+bool ObjectManager::ObjectManagerImpl::Init()
+{
+	bool ret = true;
 
 	return ret;
 }
 
-bool ObjectManager::ObjectManagerImpl::Loop(float dt)
+bool ObjectManager::ObjectManagerImpl::FixedLoop(float dt)
 {
 	bool ret = true;
 
+	//colliders can be moved from anywhere, catch the ones that changed since the last step
+	mObjectGrid.UpdateAll();
+	GeneratePairs();
+	UpdateActivationArea();
+
+	for (uint i = 0; i < objects.size(); ++i)
+	{
+		objects[i]->mPreviousX = objects[i]->collider.x;
+		objects[i]->mPreviousY = objects[i]->collider.y;
+	}
+
+	//objects can be added while looping, indices stay valid when the array grows
 	if (!is_paused)
 	{
-		for (std::list<GameObject*>::iterator it = objects.begin(); it != objects.end(); it++)
+		for (uint i = 0; i < objects.size(); ++i)
 		{
-			if (!(*it)->Loop(dt))
+			GameObject* lObject = objects[i];
+			if (IsParallel(lObject) || !IsAwake(lObject))
+			{
+				continue;
+			}
+
+			if (!lObject->Loop(dt))
 			{
 				ret = false;
 			}
+			//the next objects query the grid with this one where it is now
+			mObjectGrid.Update(lObject);
+		}
+
+		if (mParallelUpdate && !mParallelObjects.empty() && !ParallelLoop(dt))
+		{
+			ret = false;
 		}
 	}
-	
-	for (std::list<GameObject*>::iterator it = objects.begin(); it != objects.end(); it++)
+
+	//the next step can't update the objects deleted in this one
+	DeletePending();
+
+	return ret;
+}
+
+bool ObjectManager::ObjectManagerImpl::Loop(float dt)
+{
+	bool ret = true;
+
+	UpdateActivationArea();
+
+	float lAlpha = mPartInst->mApp.GetInterpolationAlpha();
+	for (uint i = 0; i < objects.size(); ++i)
 	{
-		if (!(*it)->Render())
+		GameObject* lObject = objects[i];
+		if (!IsAwake(lObject))
+		{
+			continue;
+		}
+
+		//the object is rendered between its last two steps and put back where the simulation left it
+		RXRect lCollider = lObject->collider;
+		lObject->collider = GetInterpolatedCollider(lObject, lAlpha);
+		if (!lObject->Render())
 		{
 			ret = false;
 		}
+		lObject->collider = lCollider;
+	}
+
+	DeletePending();
+
+	return ret;
+}
+
+void ObjectManager::ObjectManagerImpl::DeletePending()
+{
+	//pairs can't point to the objects about to be deleted
+	if (!to_delete.empty())
+	{
+		std::unordered_set<GameObject*>& lDeleted = to_delete;
+		mPairs.erase(std::remove_if(mPairs.begin(), mPairs.end(), [&lDeleted](const collision_pair& aPair)
+			{
+				return lDeleted.count(aPair.object) != 0 || lDeleted.count(aPair.other) != 0;
+			}), mPairs.end());
 	}
+
 	//delete the current list
 	for (std::unordered_set<GameObject*>::iterator it = to_delete.begin(); it != to_delete.end(); it++)
 	{
 		(*it)->Destroy();
-		delete(*it);
-		objects.erase(std::find(objects.begin(), objects.end(), *it));
-		
+		mObjectGrid.Remove(*it);
+		RemoveFromTypeBucket(*it);
+		UnregisterObject(*it);
+		ReleaseObject(*it);
 	}
 	to_delete.clear();
+}
 
-	return ret;
+void ObjectManager::ObjectManagerImpl::Sweep(float aX, float aY, int aW, int aH, float aDX, float aDY, unsigned int aMask, bool aWalls, GameObject* aIgnore, bool aFirstOnly, std::vector<raycast_hit>& aHits, bool aConcurrent)
+{
+	if (aWalls && mWallGridDirty && !aConcurrent)
+	{
+		BuildWallGrid();
+	}
+
+	size_t lFirst = aHits.size();
+	float lLength = sqrtf(aDX * aDX + aDY * aDY);
+	int lPieces = max(1, (int)ceilf(lLength / mObjectGrid.GetCellSize()));
+
+	//each candidate is tested against the whole movement, so it only has to be tested once
+	std::unordered_set<const void*> lTested;
+	std::vector<GameObject*> lObjects;
+	std::vector<RXRect*> lWalls;
+
+	for (int i = 0; i < lPieces; ++i)
+	{
+		float lStart = (float)i / lPieces;
+		float lEnd = (float)(i + 1) / lPieces;
+
+		//area covered by the rect during this piece, grown by one so the edges it touches are included
+		float lMinX = min(aX + aDX * lStart, aX + aDX * lEnd);
+		float lMinY = min(aY + aDY * lStart, aY + aDY * lEnd);
+		float lMaxX = max(aX + aDX * lStart, aX + aDX * lEnd) + aW;
+		float lMaxY = max(aY + aDY * lStart, aY + aDY * lEnd) + aH;
+		RXRect lArea = { (int)floorf(lMinX) - 1, (int)floorf(lMinY) - 1, 0, 0 };
+		lArea.w = (int)ceilf(lMaxX) + 1 - lArea.x;
+		lArea.h = (int)ceilf(lMaxY) + 1 - lArea.y;
+
+		lObjects.clear();
+		mObjectGrid.Query(lArea, lObjects, aMask, aConcurrent);
+		for (std::vector<GameObject*>::iterator it = lObjects.begin(); it != lObjects.end(); ++it)
+		{
+			raycast_hit lHit;
+			if (*it == aIgnore || !lTested.insert(*it).second
+				|| !SweepRectVsRect(aX, aY, aW, aH, aDX, aDY, (*it)->collider, lHit.fraction, lHit.normal_x, lHit.normal_y))
+			{
+				continue;
+			}
+			lHit.object = *it;
+			aHits.push_back(lHit);
+		}
+
+		if (aWalls)
+		{
+			lWalls.clear();
+			mWallGrid.Query(lArea, lWalls, aConcurrent);
+			for (std::vector<RXRect*>::iterator it = lWalls.begin(); it != lWalls.end(); ++it)
+			{
+				raycast_hit lHit;
+				if (!lTested.insert(*it).second
+					|| !SweepRectVsRect(aX, aY, aW, aH, aDX, aDY, **it, lHit.fraction, lHit.normal_x, lHit.normal_y))
+				{
+					continue;
+				}
+				lHit.wall = *it;
+				aHits.push_back(lHit);
+			}
+		}
+
+		//later pieces are farther away, they can't hold a closer hit than one inside of this piece
+		if (aFirstOnly)
+		{
+			bool lFound = false;
+			for (size_t j = lFirst; j < aHits.size() && !lFound; ++j)
+			{
+				lFound = aHits[j].fraction <= lEnd;
+			}
+			if (lFound)
+			{
+				break;
+			}
+		}
+	}
+
+	std::sort(aHits.begin() + lFirst, aHits.end(), [](const raycast_hit& a, const raycast_hit& b) { return a.fraction < b.fraction; });
+	if (aFirstOnly && aHits.size() > lFirst + 1)
+	{
+		aHits.resize(lFirst + 1);
+	}
+
+	for (size_t i = lFirst; i < aHits.size(); ++i)
+	{
+		aHits[i].x = aX + aDX * aHits[i].fraction;
+		aHits[i].y = aY + aDY * aHits[i].fraction;
+	}
+}
+
+void ObjectManager::ObjectManagerImpl::UpdateActivationArea()
+{
+	if (!mActivationEnabled)
+	{
+		return;
+	}
+
+	//the grid holds world coordinates, the screen area is scaled by the window
+	mActivationArea = mPartInst->mApp.GetModule<Camera>().GetWorldArea();
+	mActivationArea.x -= mActivationMargin;
+	mActivationArea.y -= mActivationMargin;
+	mActivationArea.w += mActivationMargin * 2;
+	mActivationArea.h += mActivationMargin * 2;
+
+	//objects the grid doesn't find around the area sleep
+	if (++mActivationStamp == 0)
+	{
+		for (std::vector<object_slot>::iterator it = mObjectSlots.begin(); it != mObjectSlots.end(); ++it)
+		{
+			(*it).awake_stamp = 0;
+		}
+		mActivationStamp = 1;
+	}
+
+	mActivationQuery.clear();
+	mObjectGrid.QueryCells(mActivationArea, mActivationQuery);
+	for (std::vector<GameObject*>::iterator it = mActivationQuery.begin(); it != mActivationQuery.end(); ++it)
+	{
+		//edges count as inside so objects without a collider size still wake up
+		const RXRect& lCollider = (*it)->collider;
+		if (lCollider.x <= mActivationArea.x + mActivationArea.w && lCollider.x + lCollider.w >= mActivationArea.x
+			&& lCollider.y <= mActivationArea.y + mActivationArea.h && lCollider.y + lCollider.h >= mActivationArea.y)
+		{
+			mObjectSlots[(*it)->mHandle & OBJECT_HANDLE_INDEX_MASK].awake_stamp = mActivationStamp;
+		}
+	}
+}
+
+bool ObjectManager::ObjectManagerImpl::IsAwake(GameObject* aObject)
+{
+	if (!mActivationEnabled || aObject->always_active)
+	{
+		return true;
+	}
+	return GetObjectFromHandle(aObject->mHandle) == aObject && mObjectSlots[aObject->mHandle & OBJECT_HANDLE_INDEX_MASK].awake_stamp == mActivationStamp;
+}
+
+RXRect ObjectManager::ObjectManagerImpl::GetInterpolatedCollider(GameObject* aObject, float aAlpha)
+{
+	RXRect lCollider = aObject->collider;
+	lCollider.x = aObject->mPreviousX + (int)roundf((aObject->collider.x - aObject->mPreviousX) * aAlpha);
+	lCollider.y = aObject->mPreviousY + (int)roundf((aObject->collider.y - aObject->mPreviousY) * aAlpha);
+	return lCollider;
 }
 
 void ObjectManager::ObjectManagerImpl::RenderDebug()
 {
-	for (int i = 0; i < MAX_WALLS; ++i)
+	for (int i = 0; i < (int)walls.size(); ++i)
 	{
 		if (walls[i] != nullptr)
 		{
@@ -73,13 +327,284 @@ void ObjectManager::ObjectManagerImpl::RenderDebug()
 		}
 	}
 
-	for (std::list<GameObject*>::iterator it = objects.begin(); it != objects.end(); it++)
+	for (std::vector<GameObject*>::iterator it = objects.begin(); it != objects.end(); it++)
 	{
 		(*it)->RenderDebug();
 		mPartInst->mApp.GetModule<Render>().RenderRect((*it)->collider, RXColor { 0, 255, 0, 75 }, true, RenderQueue::RENDER_DEBUG, 0);
 	}
 }
 
+bool ObjectManager::ObjectManagerImpl::ParallelLoop(float dt)
+{
+	//the workers only read the wall grid
+	if (mWallGridDirty)
+	{
+		BuildWallGrid();
+	}
+
+	//workers steal chunks from each other, commands are kept per chunk so they are applied in the same order every run
+	uint lChunks = (mParallelObjects.size() + mParallelChunkSize - 1) / mParallelChunkSize;
+	if (mCommandBuffers.size() < lChunks)
+	{
+		mCommandBuffers.resize(lChunks);
+	}
+
+	std::atomic<bool> lFailed(false);
+	mJobs.ParallelFor(mParallelObjects.size(), mParallelChunkSize, [this, dt, &lFailed](uint aBegin, uint aEnd, uint aWorker)
+		{
+			sCommands = &mCommandBuffers[aBegin / mParallelChunkSize];
+			for (uint i = aBegin; i < aEnd; ++i)
+			{
+				GameObject* lObject = mParallelObjects[i];
+				if (!IsAwake(lObject))
+				{
+					continue;
+				}
+
+				if (!lObject->Loop(dt))
+				{
+					lFailed = true;
+				}
+				//the grid is only read while the workers run
+				if (mObjectGrid.HasMoved(lObject))
+				{
+					sCommands->moved.push_back(lObject);
+				}
+			}
+			sCommands = nullptr;
+		});
+
+	//only the objects that changed cells touch the grid
+	for (std::vector<object_commands>::iterator it = mCommandBuffers.begin(); it != mCommandBuffers.end(); ++it)
+	{
+		mObjectGrid.Update(it->moved);
+		it->moved.clear();
+	}
+
+	ApplyCommands();
+	return !lFailed;
+}
+
+void ObjectManager::ObjectManagerImpl::ApplyCommands()
+{
+	for (std::vector<object_commands>::iterator it = mCommandBuffers.begin(); it != mCommandBuffers.end(); ++it)
+	{
+		for (std::vector<deferred_spawn>::iterator lSpawn = it->spawns.begin(); lSpawn != it->spawns.end(); ++lSpawn)
+		{
+			mPartInst->AddObject(lSpawn->x, lSpawn->y, lSpawn->w, lSpawn->h, lSpawn->type);
+		}
+		for (std::vector<GameObject*>::iterator lObject = it->added.begin(); lObject != it->added.end(); ++lObject)
+		{
+			mPartInst->AddObject(*lObject);
+		}
+		for (std::vector<GameObject*>::iterator lObject = it->deleted.begin(); lObject != it->deleted.end(); ++lObject)
+		{
+			to_delete.insert(*lObject);
+		}
+		for (std::vector<RXRect>::iterator lWall = it->added_walls.begin(); lWall != it->added_walls.end(); ++lWall)
+		{
+			mPartInst->AddWall(*lWall);
+		}
+		for (std::vector<int>::iterator lWall = it->deleted_walls.begin(); lWall != it->deleted_walls.end(); ++lWall)
+		{
+			mPartInst->DeleteWall(*lWall);
+		}
+
+		it->spawns.clear();
+		it->added.clear();
+		it->deleted.clear();
+		it->added_walls.clear();
+		it->deleted_walls.clear();
+	}
+}
+
+void ObjectManager::ObjectManagerImpl::GeneratePairs()
+{
+	mPairs.clear();
+	mObjectGrid.GeneratePairs(mPairs);
+
+	//every pair is stored for both objects so each one finds its pairs in a single range
+	size_t lCount = mPairs.size();
+	for (size_t i = 0; i < lCount; ++i)
+	{
+		collision_pair lMirror = { mPairs[i].other, mPairs[i].object };
+		mPairs.push_back(lMirror);
+	}
+
+	std::sort(mPairs.begin(), mPairs.end(), [](const collision_pair& a, const collision_pair& b) { return a.object < b.object; });
+}
+
+bool ObjectManager::ObjectManagerImpl::RegisterObject(GameObject* aObject)
+{
+	if (aObject->mHandle != 0)
+	{
+		return false;
+	}
+
+	uint lIndex;
+	if (!mFreeObjectSlots.empty())
+	{
+		lIndex = mFreeObjectSlots.back();
+		mFreeObjectSlots.pop_back();
+	}
+	else
+	{
+		if (mObjectSlots.size() > OBJECT_HANDLE_INDEX_MASK)
+		{
+			Logger::Console_log(LogLevel::LOG_ERROR, "Too many objects in the scene, object not added");
+			return false;
+		}
+		lIndex = mObjectSlots.size();
+		mObjectSlots.push_back(object_slot());
+	}
+
+	object_slot& lSlot = mObjectSlots[lIndex];
+	lSlot.object = aObject;
+	lSlot.dense_index = objects.size();
+	//the object appears where it was placed until its first step
+	aObject->mPreviousX = aObject->collider.x;
+	aObject->mPreviousY = aObject->collider.y;
+	aObject->mHandle = (lSlot.generation << OBJECT_HANDLE_INDEX_BITS) | lIndex;
+	//new objects are awake until the area is placed again
+	lSlot.awake_stamp = mActivationStamp;
+	objects.push_back(aObject);
+
+	FactoryBase* lFactory = FactoryBase::GetFactoryOf(aObject);
+	if (mParallelUpdate && lFactory != nullptr && lFactory->IsThreadSafe())
+	{
+		lSlot.parallel_index = mParallelObjects.size();
+		mParallelObjects.push_back(aObject);
+	}
+	return true;
+}
+
+void ObjectManager::ObjectManagerImpl::UnregisterObject(GameObject* aObject)
+{
+	if (GetObjectFromHandle(aObject->mHandle) != aObject)
+	{
+		return;
+	}
+
+	uint lIndex = aObject->mHandle & OBJECT_HANDLE_INDEX_MASK;
+	object_slot& lSlot = mObjectSlots[lIndex];
+
+	//the last object of the array takes the place of the removed one
+	GameObject* lLast = objects.back();
+	objects[lSlot.dense_index] = lLast;
+	mObjectSlots[lLast->mHandle & OBJECT_HANDLE_INDEX_MASK].dense_index = lSlot.dense_index;
+	objects.pop_back();
+
+	if (lSlot.parallel_index != -1)
+	{
+		GameObject* lLastParallel = mParallelObjects.back();
+		mParallelObjects[lSlot.parallel_index] = lLastParallel;
+		mObjectSlots[lLastParallel->mHandle & OBJECT_HANDLE_INDEX_MASK].parallel_index = lSlot.parallel_index;
+		mParallelObjects.pop_back();
+		lSlot.parallel_index = -1;
+	}
+
+	//handles given for this slot become stale
+	lSlot.object = nullptr;
+	lSlot.generation = (lSlot.generation + 1) & OBJECT_HANDLE_GENERATION_MASK;
+	if (lSlot.generation == 0)
+	{
+		lSlot.generation = 1;
+	}
+	mFreeObjectSlots.push_back(lIndex);
+	aObject->mHandle = 0;
+}
+
+bool ObjectManager::ObjectManagerImpl::IsParallel(GameObject* aObject)
+{
+	return mObjectSlots[aObject->mHandle & OBJECT_HANDLE_INDEX_MASK].parallel_index != -1;
+}
+
+GameObject* ObjectManager::ObjectManagerImpl::GetObjectFromHandle(ObjectHandle aHandle)
+{
+	uint lIndex = aHandle & OBJECT_HANDLE_INDEX_MASK;
+	uint lGeneration = aHandle >> OBJECT_HANDLE_INDEX_BITS;
+
+	if (lIndex >= mObjectSlots.size())
+	{
+		return nullptr;
+	}
+
+	object_slot& lSlot = mObjectSlots[lIndex];
+	if (lSlot.object == nullptr || lSlot.generation != lGeneration)
+	{
+		return nullptr;
+	}
+	return lSlot.object;
+}
+
+void ObjectManager::ObjectManagerImpl::AddToTypeBucket(GameObject* aObject)
+{
+	if (mTypeBucketIndex.find(aObject) != mTypeBucketIndex.end())
+	{
+		return;
+	}
+
+	std::vector<GameObject*>& lBucket = mTypeBuckets[aObject->mType];
+	mTypeBucketIndex[aObject] = lBucket.size();
+	lBucket.push_back(aObject);
+}
+
+void ObjectManager::ObjectManagerImpl::RemoveFromTypeBucket(GameObject* aObject)
+{
+	std::unordered_map<GameObject*, uint>::iterator lIndex = mTypeBucketIndex.find(aObject);
+	if (lIndex == mTypeBucketIndex.end())
+	{
+		return;
+	}
+
+	//the last object of the bucket takes the place of the removed one
+	std::vector<GameObject*>& lBucket = mTypeBuckets[aObject->mType];
+	GameObject* lLast = lBucket.back();
+	lBucket[lIndex->second] = lLast;
+	mTypeBucketIndex[lLast] = lIndex->second;
+	lBucket.pop_back();
+	mTypeBucketIndex.erase(aObject);
+}
+
+EngineAPI* ObjectManager::ObjectManagerImpl::NewEngine()
+{
+	if (mFreeEngines.empty())
+	{
+		return new EngineAPI(mPartInst->mApp);
+	}
+
+	EngineAPI* lEngine = mFreeEngines.back();
+	mFreeEngines.pop_back();
+	return lEngine;
+}
+
+void ObjectManager::ObjectManagerImpl::ReleaseObject(GameObject* aObject)
+{
+	if (aObject->Engine != nullptr)
+	{
+		//the modules disabled by the previous object don't carry over
+		aObject->Engine->mDisabledModules.clear();
+		mFreeEngines.push_back(aObject->Engine);
+		aObject->Engine = nullptr;
+	}
+
+	FactoryBase* lFactory = FactoryBase::GetFactoryOf(aObject);
+	if (lFactory != nullptr)
+	{
+		lFactory->DestroyInstance(aObject);
+	}
+	else
+	{
+		delete aObject;
+	}
+}
+
+void ObjectManager::ObjectManagerImpl::BuildWallGrid()
+{
+	mWallGrid.Build(walls);
+	mWallGridDirty = false;
+}
+
 FactoryBase* ObjectManager::ObjectManagerImpl::GetFactory(const char* aNameInMap)
 {
 	for (std::list<FactoryBase*>::iterator it = mFactories.begin(); it != mFactories.end(); it++)
@@ -105,12 +630,20 @@ FactoryBase* ObjectManager::ObjectManagerImpl::GetFactory(std::type_index& aType
 
 bool ObjectManager::ObjectManagerImpl::CleanUp()
 {
+	mJobs.Stop();
 	mPartInst->Clearphysics();
 
 	for (std::list<FactoryBase*>::iterator it = mFactories.begin(); it != mFactories.end(); it++)
 	{
 		delete* it;
 	}
+	mFactories.clear();
+
+	for (std::vector<EngineAPI*>::iterator it = mFreeEngines.begin(); it != mFreeEngines.end(); it++)
+	{
+		delete* it;
+	}
+	mFreeEngines.clear();
 	return true;
 }
 
@@ -127,16 +660,14 @@ void ObjectManager::GetNearbyWalls(int x, int y, int pxls_range, std::vector<RXR
 		return;
 	}
 
-	RXRect* toleration_area = new RXRect();
-	*toleration_area = {x-pxls_range, y -pxls_range, pxls_range*2, pxls_range*2};
-
-	for (int i = 0; i < MAX_WALLS; ++i)
+	//walls added or removed outside of a map load are picked up here
+	if (lImpl->mWallGridDirty && sCommands == nullptr)
 	{
-		if (RXRectCollision(lImpl->walls[i], toleration_area))
-		{
-			colliders_near.push_back(lImpl->walls[i]);
-		}
+		lImpl->BuildWallGrid();
 	}
+
+	RXRect toleration_area = {x-pxls_range, y -pxls_range, pxls_range*2, pxls_range*2};
+	lImpl->mWallGrid.Query(toleration_area, colliders_near, sCommands != nullptr);
 }
 std::vector<GameObject*>* ObjectManager::GetAllObjectsOfType(std::type_index info)
 {
@@ -147,16 +678,26 @@ std::vector<GameObject*>* ObjectManager::GetAllObjectsOfType(std::type_index inf
 		return nullptr;
 	}
 
-	std::vector<GameObject*>* ret = new std::vector<GameObject*>();
+	return new std::vector<GameObject*>(GetObjectsOfType(info));
+}
+
+const std::vector<GameObject*>& ObjectManager::GetObjectsOfType(std::type_index info)
+{
+	static std::vector<GameObject*> sEmpty;
 
-	for (std::list<GameObject*>::iterator it = lImpl->objects.begin(); it != lImpl->objects.end(); it++)
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
 	{
-		if ((*it)->mType == info)
-		{
-			ret->push_back(*it);
-		}
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return sEmpty;
 	}
-	return ret;
+
+	std::unordered_map<std::type_index, std::vector<GameObject*>>::iterator it = lImpl->mTypeBuckets.find(info);
+	if (it == lImpl->mTypeBuckets.end())
+	{
+		return sEmpty;
+	}
+	return it->second;
 }
 
 void ObjectManager::GetCollisions(RXRect* obj, std::vector<collision*>& collisions)
@@ -168,14 +709,64 @@ void ObjectManager::GetCollisions(RXRect* obj, std::vector<collision*>& collisio
 		return;
 	}
 
-	for (std::list<GameObject*>::iterator it = lImpl->objects.begin(); it != lImpl->objects.end(); it++)
+	if (obj == nullptr)
 	{
-		if (RXRectCollision(&(*it)->collider,obj))
-		{
-			collision* col = new collision();
-			col->object = *it;
-			collisions.push_back(col);
-		}
+		return;
+	}
+
+	std::vector<GameObject*> lObjects;
+	lImpl->mObjectGrid.Query(*obj, lObjects, 0xFFFFFFFF, sCommands != nullptr);
+
+	for (std::vector<GameObject*>::iterator it = lObjects.begin(); it != lObjects.end(); it++)
+	{
+		collision* col = new collision();
+		col->object = *it;
+		collisions.push_back(col);
+	}
+}
+
+void ObjectManager::GetCollisions(const RXRect& rect, std::vector<GameObject*>& collisions, unsigned int mask)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	lImpl->mObjectGrid.Query(rect, collisions, mask, sCommands != nullptr);
+}
+
+const std::vector<collision_pair>& ObjectManager::GetCollisionPairs()
+{
+	static std::vector<collision_pair> sEmpty;
+
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return sEmpty;
+	}
+
+	return lImpl->mPairs;
+}
+
+void ObjectManager::GetCollisionPairsOf(GameObject* object, std::vector<GameObject*>& others)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	collision_pair lKey = { object, nullptr };
+	std::vector<collision_pair>::iterator it = std::lower_bound(lImpl->mPairs.begin(), lImpl->mPairs.end(), lKey,
+		[](const collision_pair& a, const collision_pair& b) { return a.object < b.object; });
+
+	for (; it != lImpl->mPairs.end() && (*it).object == object; ++it)
+	{
+		others.push_back((*it).other);
 	}
 }
 
@@ -197,9 +788,14 @@ GameObject* ObjectManager::AddObject(int x, int y, int w_col, int h_col,std::typ
 		return nullptr;
 	}
 
-	auto lID = lImpl->GetFactory(lType);
+	if (sCommands != nullptr)
+	{
+		deferred_spawn lSpawn = { x, y, w_col, h_col, lType };
+		sCommands->spawns.push_back(lSpawn);
+		return nullptr;
+	}
 
-	std::list<ObjectProperty*> lPropList;
+	auto lID = lImpl->GetFactory(lType);
 
 	GameObject* r = (*lID).CreateInstace();
 	if (r != nullptr)
@@ -207,15 +803,18 @@ GameObject* ObjectManager::AddObject(int x, int y, int w_col, int h_col,std::typ
 		r->mType = lID->GetObjectTypeIndex();
 		r->collider = {0,0,0,0};
 
-		r->Engine = new EngineAPI(mApp);
+		r->Engine = lImpl->NewEngine();
 		r->collider.x = x;
 		r->collider.y = y;
 		r->collider.w = w_col;
 		r->collider.h = h_col;
 
-		r->Init();
+		//the object has its handle during Init
+		lImpl->RegisterObject(r);
+		lImpl->mObjectGrid.Insert(r);
+		lImpl->AddToTypeBucket(r);
 
-		lImpl->objects.push_back(r);
+		r->Init();
 	}
 	else
 	{
@@ -227,6 +826,168 @@ GameObject* ObjectManager::AddObject(int x, int y, int w_col, int h_col,std::typ
 	return r;
 }
 
+GameObject* ObjectManager::GetObjectFromHandle(ObjectHandle aHandle)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return nullptr;
+	}
+
+	return lImpl->GetObjectFromHandle(aHandle);
+}
+
+RXRect ObjectManager::GetInterpolatedCollider(GameObject* object)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return object->collider;
+	}
+
+	return lImpl->GetInterpolatedCollider(object, mApp.GetInterpolationAlpha());
+}
+
+bool ObjectManager::Raycast(float x1, float y1, float x2, float y2, raycast_hit& hit, unsigned int mask, bool walls, GameObject* ignore)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return false;
+	}
+
+	std::vector<raycast_hit> lHits;
+	lImpl->Sweep(x1, y1, 0, 0, x2 - x1, y2 - y1, mask, walls, ignore, true, lHits, sCommands != nullptr);
+	if (lHits.empty())
+	{
+		return false;
+	}
+	hit = lHits.front();
+	return true;
+}
+
+int ObjectManager::RaycastAll(float x1, float y1, float x2, float y2, std::vector<raycast_hit>& hits, unsigned int mask, bool walls, GameObject* ignore)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	size_t lBefore = hits.size();
+	lImpl->Sweep(x1, y1, 0, 0, x2 - x1, y2 - y1, mask, walls, ignore, false, hits, sCommands != nullptr);
+	return hits.size() - lBefore;
+}
+
+bool ObjectManager::SweepRect(const RXRect& rect, float dx, float dy, raycast_hit& hit, unsigned int mask, bool walls, GameObject* ignore)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return false;
+	}
+
+	std::vector<raycast_hit> lHits;
+	lImpl->Sweep(rect.x, rect.y, rect.w, rect.h, dx, dy, mask, walls, ignore, true, lHits, sCommands != nullptr);
+	if (lHits.empty())
+	{
+		return false;
+	}
+	hit = lHits.front();
+	return true;
+}
+
+int ObjectManager::SweepRectAll(const RXRect& rect, float dx, float dy, std::vector<raycast_hit>& hits, unsigned int mask, bool walls, GameObject* ignore)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	size_t lBefore = hits.size();
+	lImpl->Sweep(rect.x, rect.y, rect.w, rect.h, dx, dy, mask, walls, ignore, false, hits, sCommands != nullptr);
+	return hits.size() - lBefore;
+}
+
+int ObjectManager::OverlapCircle(float x, float y, float radius, std::vector<GameObject*>& objects, std::vector<RXRect*>& walls, unsigned int mask)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	if (radius <= 0)
+	{
+		return 0;
+	}
+
+	bool lConcurrent = sCommands != nullptr;
+	if (lImpl->mWallGridDirty && !lConcurrent)
+	{
+		lImpl->BuildWallGrid();
+	}
+
+	//the grids find what overlaps the square around the circle, the corners are filtered out after
+	RXRect lArea = { (int)floorf(x - radius), (int)floorf(y - radius), 0, 0 };
+	lArea.w = (int)ceilf(x + radius) - lArea.x;
+	lArea.h = (int)ceilf(y + radius) - lArea.y;
+
+	int lCount = 0;
+	size_t lFirst = objects.size();
+	lImpl->mObjectGrid.Query(lArea, objects, mask, lConcurrent);
+	std::vector<GameObject*>::iterator lObjectsEnd = std::remove_if(objects.begin() + lFirst, objects.end(),
+		[x, y, radius](GameObject* aObject) { return !CircleOverlapsRect(x, y, radius, aObject->collider); });
+	objects.erase(lObjectsEnd, objects.end());
+	lCount += objects.size() - lFirst;
+
+	lFirst = walls.size();
+	lImpl->mWallGrid.Query(lArea, walls, lConcurrent);
+	std::vector<RXRect*>::iterator lWallsEnd = std::remove_if(walls.begin() + lFirst, walls.end(),
+		[x, y, radius](RXRect* aWall) { return !CircleOverlapsRect(x, y, radius, *aWall); });
+	walls.erase(lWallsEnd, walls.end());
+	lCount += walls.size() - lFirst;
+
+	return lCount;
+}
+
+bool ObjectManager::IsObjectAwake(GameObject* object)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return false;
+	}
+
+	return object != nullptr && lImpl->IsAwake(object);
+}
+
+void ObjectManager::SetActivationMargin(int margin)
+{
+	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	lImpl->mActivationMargin = margin;
+}
+
+bool ObjectManager::IsObjectAlive(ObjectHandle aHandle)
+{
+	return GetObjectFromHandle(aHandle) != nullptr;
+}
+
 int ObjectManager::GetTotalObjectNumber()
 {
 	ObjectManagerImpl* lImpl = dynamic_cast<ObjectManagerImpl*>(mPartFuncts);
@@ -247,8 +1008,17 @@ void ObjectManager::AddObject(GameObject* lToAdd)
 		return;
 	}
 
-	if(lToAdd != nullptr)
-		lImpl->objects.push_back(lToAdd);
+	if (sCommands != nullptr)
+	{
+		sCommands->added.push_back(lToAdd);
+		return;
+	}
+
+	if (lToAdd != nullptr && lImpl->RegisterObject(lToAdd))
+	{
+		lImpl->mObjectGrid.Insert(lToAdd);
+		lImpl->AddToTypeBucket(lToAdd);
+	}
 }
 
 int ObjectManager::AddWall(RXRect& rect)
@@ -260,29 +1030,31 @@ int ObjectManager::AddWall(RXRect& rect)
 		return -1;
 	}
 
-	int i = 0;
-	bool exit = false;
-
-	while (i < MAX_WALLS && !exit)
+	if (sCommands != nullptr)
 	{
-		if (lImpl->walls[i] == nullptr)
-		{
-			exit = true;
-
-		}
-		else
-		{
-			++i;
-		}
+		sCommands->added_walls.push_back(rect);
+		return -1;
 	}
-	
+
 	RXRect* wall = new RXRect();
 	wall->x = rect.x;
 	wall->y = rect.y;
 	wall->w = rect.w;
 	wall->h = rect.h;
 
-	lImpl->walls[i] = wall;
+	int i;
+	if (!lImpl->mFreeWalls.empty())
+	{
+		i = lImpl->mFreeWalls.back();
+		lImpl->mFreeWalls.pop_back();
+		lImpl->walls[i] = wall;
+	}
+	else
+	{
+		i = lImpl->walls.size();
+		lImpl->walls.push_back(wall);
+	}
+	lImpl->mWallGridDirty = true;
 
 	return i;
 }
@@ -296,8 +1068,21 @@ void ObjectManager::DeleteWall(int id)
 		return;
 	}
 
+	if (sCommands != nullptr)
+	{
+		sCommands->deleted_walls.push_back(id);
+		return;
+	}
+
+	if (id < 0 || id >= (int)lImpl->walls.size() || lImpl->walls[id] == nullptr)
+	{
+		return;
+	}
+
 	delete lImpl->walls[id];
 	lImpl->walls[id] = nullptr;
+	lImpl->mFreeWalls.push_back(id);
+	lImpl->mWallGridDirty = true;
 }
 
 bool ObjectManager::AddFactory(FactoryBase* aFactory)
@@ -325,22 +1110,29 @@ bool ObjectManager::Clearphysics()
 	Logger::Console_log(LogLevel::LOG_INFO, "Clearing UI physics");
 	bool ret = true;
 
-	for (int i = 0; i < MAX_WALLS; ++i)
+	for (std::vector<RXRect*>::iterator it = lImpl->walls.begin(); it != lImpl->walls.end(); it++)
 	{
-		if (lImpl->walls[i] != nullptr)
-		{
-			delete lImpl->walls[i];
-			lImpl->walls[i] = nullptr;
-		}
+		delete *it;
 	}
+	lImpl->walls.clear();
+	lImpl->mFreeWalls.clear();
+	lImpl->mWallGrid.Clear();
+	lImpl->mWallGridDirty = false;
 
-	for (std::list<GameObject*>::iterator it = lImpl->objects.begin(); it != lImpl->objects.end(); it++)
+	//objects are taken from the back so the swap on removal does nothing
+	while (!lImpl->objects.empty())
 	{
-		(*it)->Destroy();
-		delete (*it)->Engine;
-		delete *it;
+		GameObject* lObject = lImpl->objects.back();
+		lObject->Destroy();
+		lImpl->UnregisterObject(lObject);
+		lImpl->ReleaseObject(lObject);
 	}
-	lImpl->objects.clear();
+	//deletions requested before clearing point to objects that are gone
+	lImpl->to_delete.clear();
+	lImpl->mObjectGrid.Clear();
+	lImpl->mPairs.clear();
+	lImpl->mTypeBuckets.clear();
+	lImpl->mTypeBucketIndex.clear();
 
 	return ret;
 }
@@ -353,6 +1145,12 @@ void ObjectManager::DeleteObject(GameObject* _to_delete)
 		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
 		return;
 	}
+
+	if (sCommands != nullptr)
+	{
+		sCommands->deleted.push_back(_to_delete);
+		return;
+	}
 	lImpl->to_delete.insert(_to_delete);
 }
 
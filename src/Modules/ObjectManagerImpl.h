@@ -4,6 +4,47 @@
 #include "../include/Modules/ObjectManager.h"
 #include "EngineElements/GameObject.h"
 #include "PartImpl.h"
+#include "SpatialHash.h"
+#include "WallGrid.h"
+#include "JobSystem.h"
+#include <unordered_map>
+
+#define ACTIVATION_DEFAULT_MARGIN 256
+
+#define OBJECT_HANDLE_INDEX_BITS 20
+#define OBJECT_HANDLE_INDEX_MASK ((1u << OBJECT_HANDLE_INDEX_BITS) - 1)
+#define OBJECT_HANDLE_GENERATION_MASK ((1u << (32 - OBJECT_HANDLE_INDEX_BITS)) - 1)
+
+struct object_slot
+{
+	GameObject* object = nullptr;
+	//starts at 1 so that 0 is never a valid handle
+	uint generation = 1;
+	//position of the object in the dense array
+	uint dense_index = 0;
+	//position of the object in the parallel list, -1 if it is updated serially
+	int parallel_index = -1;
+	//the object is awake while this matches the activation stamp
+	uint awake_stamp = 0;
+};
+
+struct deferred_spawn
+{
+	int x, y, w, h;
+	std::type_index type;
+};
+
+//changes asked by the objects updated in parallel, applied once all of them are done
+struct object_commands
+{
+	std::vector<deferred_spawn> spawns;
+	std::vector<GameObject*> added;
+	std::vector<GameObject*> deleted;
+	std::vector<RXRect> added_walls;
+	std::vector<int> deleted_walls;
+	//objects that left their grid cells
+	std::vector<GameObject*> moved;
+};
 
 class ObjectManager::ObjectManagerImpl : public Part::Part_Impl
 {
@@ -19,19 +60,98 @@ public:
 	FactoryBase* GetFactory(const char* aNameInMap);
 	void RenderDebug();
 
+	//returns an engine reference for a new object, reusing the ones of deleted objects
+	EngineAPI* NewEngine();
+	//destroys the object, giving it back to its factory's pool if it has one
+	void ReleaseObject(GameObject* aObject);
+
+	GameObject* GetObjectFromHandle(ObjectHandle aHandle);
+	//the collider of the object placed between its last two simulation steps
+	RXRect GetInterpolatedCollider(GameObject* aObject, float aAlpha);
+	/*moves a rect of aW x aH from aX, aY by aDX, aDY and adds what it touches to aHits sorted by fraction
+	the movement is checked in pieces of one grid cell so the search stops at the first piece with a hit when only the first one is wanted*/
+	void Sweep(float aX, float aY, int aW, int aH, float aDX, float aDY, unsigned int aMask, bool aWalls, GameObject* aIgnore, bool aFirstOnly, std::vector<raycast_hit>& aHits, bool aConcurrent);
+	//false for the objects outside of the activation area, they skip Loop and Render
+	bool IsAwake(GameObject* aObject);
+	//builds the wall grid with the walls there are now, called once the walls of a map are loaded
+	void BuildWallGrid();
+
 protected:
+	bool LoadConfig(pugi::xml_node& config_node);
+	bool CreateConfig(pugi::xml_node& config_node);
 	bool Init();
+	bool FixedLoop(float dt);
 	bool Loop(float dt);
 	bool CleanUp();
 
+	//destroys the objects asked to be deleted
+	void DeletePending();
+	//places the activation area around the camera and wakes the objects the grid finds in it
+	void UpdateActivationArea();
+
+	//finds every pair of colliding objects in one pass over the grid
+	void GeneratePairs();
+	//updates the objects with a thread safe Loop across the job system
+	bool ParallelLoop(float dt);
+	//applies what the objects asked for during the parallel update, in worker order
+	void ApplyCommands();
+
+	//gives the object a slot and a handle and adds it to the dense array
+	bool RegisterObject(GameObject* aObject);
+	//removes the object from the dense array and invalidates its handle
+	void UnregisterObject(GameObject* aObject);
+	//true for the objects updated by the job system
+	bool IsParallel(GameObject* aObject);
+
+	//keeps the object in the list of its type
+	void AddToTypeBucket(GameObject* aObject);
+	void RemoveFromTypeBucket(GameObject* aObject);
+
 private:
 
 	bool is_paused = false;
-	RXRect* walls[MAX_WALLS];
+	//indexed by wall id, deleted walls leave a nullptr until the id is reused
+	std::vector<RXRect*> walls;
+	std::vector<int> mFreeWalls;
+	WallGrid mWallGrid;
+	//set when walls change after the grid was built
+	bool mWallGridDirty = false;
 
 	std::list<FactoryBase*> mFactories;
-	std::list<GameObject*> objects;
+	//every object in the scene, in no particular order
+	std::vector<GameObject*> objects;
+	std::vector<object_slot> mObjectSlots;
+	std::vector<uint> mFreeObjectSlots;
 	std::unordered_set<GameObject*> to_delete;
+	//broadphase for the object colliders
+	SpatialHash mObjectGrid;
+	//overlapping pairs found at the start of the frame, sorted by object
+	std::vector<collision_pair> mPairs;
+
+	//objects of every type, in no particular order
+	std::unordered_map<std::type_index, std::vector<GameObject*>> mTypeBuckets;
+	//position of every object inside of its bucket
+	std::unordered_map<GameObject*, uint> mTypeBucketIndex;
+
+	//engine references of deleted objects, ready to be given to new ones
+	std::vector<EngineAPI*> mFreeEngines;
+
+	//objects away from the camera sleep when enabled
+	bool mActivationEnabled = false;
+	//extra pixels around the screen where objects stay awake
+	int mActivationMargin = ACTIVATION_DEFAULT_MARGIN;
+	RXRect mActivationArea = { 0,0,0,0 };
+	//changes every time the activation area is placed
+	uint mActivationStamp = 0;
+	std::vector<GameObject*> mActivationQuery;
+
+	bool mParallelUpdate = false;
+	uint mParallelChunkSize = JOB_SYSTEM_DEFAULT_CHUNK_SIZE;
+	JobSystem mJobs;
+	//objects of thread safe factories, kept as they are added and removed
+	std::vector<GameObject*> mParallelObjects;
+	//one per chunk of mParallelObjects, applied in chunk order
+	std::vector<object_commands> mCommandBuffers;
 
 	friend class ObjectManager;
 
@@ -15,7 +15,11 @@ protected:
 	virtual bool CreateConfig(pugi::xml_node&) { return true; };
 
 	virtual bool Init() { return true; }
+	//called once per frame before the fixed steps
+	virtual bool PreLoop() { return true; };
 	virtual bool Loop(float dt) { return true; };
+	//called zero or more times per frame before Loop, always with the same dt
+	virtual bool FixedLoop(float dt) { return true; };
 	virtual bool CleanUp() { return true; };
 
 	friend class Application;
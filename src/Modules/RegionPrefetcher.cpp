@@ -0,0 +1,88 @@
+#include "RXpch.h"
+#include "RegionPrefetcher.h"
+#include "MappedFile.h"
+
+void RegionPrefetcher::Start()
+{
+	if (mThread.joinable())
+	{
+		return;
+	}
+
+	mStopping = false;
+	mThread = std::thread(&RegionPrefetcher::WorkerLoop, this);
+}
+
+void RegionPrefetcher::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lLock(mMutex);
+		mStopping = true;
+	}
+	mJobQueued.notify_all();
+
+	if (mThread.joinable())
+	{
+		mThread.join();
+	}
+
+	while (!mQueued.empty())
+	{
+		mQueued.pop();
+	}
+	while (!mFinished.empty())
+	{
+		mFinished.pop();
+	}
+}
+
+void RegionPrefetcher::Push(prefetch_job& aJob)
+{
+	{
+		std::lock_guard<std::mutex> lLock(mMutex);
+		mQueued.push(std::move(aJob));
+	}
+	mJobQueued.notify_one();
+}
+
+bool RegionPrefetcher::PopFinished(int& aRegion)
+{
+	std::lock_guard<std::mutex> lLock(mMutex);
+	if (mFinished.empty())
+	{
+		return false;
+	}
+
+	aRegion = mFinished.front();
+	mFinished.pop();
+	return true;
+}
+
+void RegionPrefetcher::WorkerLoop()
+{
+	while (true)
+	{
+		prefetch_job lJob;
+		{
+			std::unique_lock<std::mutex> lLock(mMutex);
+			mJobQueued.wait(lLock, [this]() { return mStopping || !mQueued.empty(); });
+			if (mStopping)
+			{
+				return;
+			}
+
+			lJob = std::move(mQueued.front());
+			mQueued.pop();
+		}
+
+		for (std::vector<prefetch_range>::iterator it = lJob.ranges.begin(); it != lJob.ranges.end(); ++it)
+		{
+			MappedFile::Prefetch((*it).data, (*it).size);
+		}
+
+		{
+			std::lock_guard<std::mutex> lLock(mMutex);
+			mFinished.push(lJob.region);
+		}
+	}
+}
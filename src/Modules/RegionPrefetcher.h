@@ -0,0 +1,53 @@
+#ifndef REGION_PREFETCHER__H
+#define REGION_PREFETCHER__H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//memory inside of a mapped file that a region is going to use
+struct prefetch_range
+{
+	const char* data;
+	size_t size;
+};
+
+struct prefetch_job
+{
+	int region;
+	std::vector<prefetch_range> ranges;
+};
+
+/*thread that reads the tiles of the regions that are about to be streamed in
+the tiles of compiled maps come from a mapped file, the first read of each page waits for the disk
+the ranges have to stay mapped until the prefetcher is stopped*/
+class RegionPrefetcher
+{
+public:
+	~RegionPrefetcher() { Stop(); }
+
+	void Start();
+	//waits for the thread, the jobs that were not done are thrown away
+	void Stop();
+	bool IsRunning() { return mThread.joinable(); }
+
+	void Push(prefetch_job& aJob);
+	//takes the region of a finished job, returns false if there is none
+	bool PopFinished(int& aRegion);
+
+private:
+	void WorkerLoop();
+
+	std::thread mThread;
+	std::queue<prefetch_job> mQueued;
+	std::queue<int> mFinished;
+	bool mStopping = false;
+
+	std::mutex mMutex;
+	//signaled when a job is queued or the thread stops
+	std::condition_variable mJobQueued;
+};
+
+#endif // !REGION_PREFETCHER__H
@@ -21,6 +21,16 @@ Render::Render(EngineAPI& aAPI) :Part("Render",aAPI)
 
 #pragma region IMPLEMENTATION
 
+//sees the reset as soon as it is pushed, no matter which part polls the events
+static int SDLCALL RenderTargetsResetWatch(void* aUserData, SDL_Event* aEvent)
+{
+	if (aEvent->type == SDL_RENDER_TARGETS_RESET)
+	{
+		((Render::RenderImpl*)aUserData)->InvalidateRenderTargets();
+	}
+	return 0;
+}
+
 bool Render::RenderImpl::LoadConfig(pugi::xml_node& config_node)
 {
 	bool ret = true;
@@ -32,8 +42,10 @@ bool Render::RenderImpl::LoadConfig(pugi::xml_node& config_node)
 	background.b = color_node.attribute("b").as_float(0);
 	background.a = color_node.attribute("a").as_float(0);
 
-	// load flags
-	Uint32 flags = SDL_RENDERER_ACCELERATED;
+	// load flags, target textures are used to cache the tile layers
+	Uint32 flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+
+	mChunkKeepRadius = max(config_node.child("tile_chunks").attribute("keep_radius").as_int(TILE_CHUNK_DEFAULT_KEEP_RADIUS), 0);
 
 	if (config_node.child("vsync").attribute("on").as_bool(true))//if config vsync
 	{
@@ -63,33 +75,98 @@ bool Render::RenderImpl::CreateConfig(pugi::xml_node& config_node)
 
 	//vsync will be on by default
 	config_node.append_child("vsync").append_attribute("on") = true;
+
+	config_node.append_child("tile_chunks").append_attribute("keep_radius") = TILE_CHUNK_DEFAULT_KEEP_RADIUS;
 	return ret;
 }
 
 
-std::priority_queue<BlitItem*, std::vector<BlitItem*>, Comparer>* Render::RenderImpl::GetQueue(RenderQueue aQueue)
+void Render::RenderImpl::PushCommand(BlitItem* aItem, RenderQueue aQueue, TextureID aTexture)
 {
-	switch (aQueue)
+	//higher depths are drawn first, so the depth is inverted to sort ascending
+	int lDepth = aItem->depth;
+	if (lDepth < -32768)
 	{
-	case RENDER_GAME:
-		return &allQueue;
-		break;
-	case RENDER_UI:
-		return &uiQueue;
-		break;
-	case RENDER_DEBUG:
-		return &debugQueue;
-		break;
-	default:
-		break;
+		lDepth = -32768;
+	}
+	else if (lDepth > 32767)
+	{
+		lDepth = 32767;
 	}
+	uint64 lDepthKey = (uint64)(32767 - lDepth);
+
+	uint64 lQueueKey = (uint64)aQueue & ((1ull << SORTKEY_QUEUE_BITS) - 1);
+	uint64 lTextureKey = (uint64)aTexture & ((1ull << SORTKEY_TEXTURE_BITS) - 1);
+	uint64 lOrderKey = (uint64)mCommands.size() & ((1ull << SORTKEY_ORDER_BITS) - 1);
 
+	RenderCommand lCommand;
+	lCommand.key = (lQueueKey << (SORTKEY_DEPTH_BITS + SORTKEY_TEXTURE_BITS + SORTKEY_ORDER_BITS))
+		| (lDepthKey << (SORTKEY_TEXTURE_BITS + SORTKEY_ORDER_BITS))
+		| (lTextureKey << SORTKEY_ORDER_BITS)
+		| lOrderKey;
+	lCommand.item = aItem;
+
+	mCommands.push_back(lCommand);
+}
+
+//LSD radix sort on the 64 bit keys, one byte per pass
+//passes where every key has the same byte are skipped, which is the common case for the queue and depth bytes
+void Render::RenderImpl::SortCommands()
+{
+	size_t lAmount = mCommands.size();
+	if (lAmount < 2)
+	{
+		return;
+	}
+
+	mSortBuffer.resize(lAmount);
+	RenderCommand* lSource = mCommands.data();
+	RenderCommand* lDestination = mSortBuffer.data();
+
+	for (int lShift = 0; lShift < 64; lShift += 8)
+	{
+		size_t lCount[256] = { 0 };
+		for (size_t i = 0; i < lAmount; ++i)
+		{
+			++lCount[(lSource[i].key >> lShift) & 0xFF];
+		}
+
+		if (lCount[(lSource[0].key >> lShift) & 0xFF] == lAmount)
+		{
+			continue;
+		}
+
+		size_t lOffset = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			size_t lBucketSize = lCount[i];
+			lCount[i] = lOffset;
+			lOffset += lBucketSize;
+		}
+
+		for (size_t i = 0; i < lAmount; ++i)
+		{
+			lDestination[lCount[(lSource[i].key >> lShift) & 0xFF]++] = lSource[i];
+		}
+
+		RenderCommand* lSwap = lSource;
+		lSource = lDestination;
+		lDestination = lSwap;
+	}
+
+	if (lSource != mCommands.data())
+	{
+		mCommands.swap(mSortBuffer);
+	}
 }
 
 bool Render::RenderImpl::Init()
 {
 	bool ret = true;
 
+	//the chunk textures of the tile layers are baked again after a reset
+	SDL_AddEventWatch(RenderTargetsResetWatch, this);
+
 	return ret;
 }
 
@@ -100,70 +177,106 @@ bool Render::RenderImpl::Loop(float dt)
 
 	mDrawCallsLastFrame = 0;
 
-	for (int i = 0; i < RenderQueue::RENDER_MAX; i++)
-	{
-		std::priority_queue<BlitItem*, std::vector<BlitItem*>, Comparer>* lQueue = GetQueue((RenderQueue)i);
-		
-		while (!lQueue->empty())
-		{
-			BlitItem* lNextItem = lQueue->top();
-			lQueue->pop();
+	SortCommands();
 
-			lNextItem->Blit(*mPartInst, mPartInst->mApp.GetModule<Camera>(), mPartInst->mApp.GetModule<Window>());
-			delete lNextItem;
-		}
+	Camera& lCamera = mPartInst->mApp.GetModule<Camera>();
+	Window& lWindow = mPartInst->mApp.GetModule<Window>();
+	for (std::vector<RenderCommand>::iterator it = mCommands.begin(); it != mCommands.end(); ++it)
+	{
+		BlitItemByType((*it).item, lCamera, lWindow);
 	}
+	mCommands.clear();
+
+	//every command of this frame has been drawn, the memory can be reused
+	mFrameArena.Reset();
 
 	SDL_SetRenderDrawColor(renderer, background.r, background.g, background.g, background.a);
 	SDL_RenderPresent(renderer);
 	return ret;
 }
 
+void Render::RenderImpl::BlitItemByType(BlitItem* aItem, Camera& aCamera, Window& aWindow)
+{
+	switch (aItem->type)
+	{
+	case BLIT_TEXTURE:
+		((BlitTexture*)aItem)->Blit(*mPartInst, aCamera, aWindow);
+		break;
+	case BLIT_TEXT:
+		((BlitItemText*)aItem)->Blit(*mPartInst, aCamera, aWindow);
+		break;
+	case BLIT_LAYER:
+		((BlitLayer*)aItem)->Blit(*mPartInst, aCamera, aWindow);
+		break;
+	case BLIT_BACKGROUND:
+		((BlitBackground*)aItem)->Blit(*mPartInst, aCamera, aWindow);
+		break;
+	case BLIT_PARTICLES:
+		((BlitParticles*)aItem)->Blit(*mPartInst, aCamera, aWindow);
+		break;
+	case BLIT_RECT:
+		((BlitRect*)aItem)->Blit(*mPartInst, aCamera, aWindow);
+		break;
+	case BLIT_TRAIL:
+		((BlitTrail*)aItem)->Blit(*mPartInst, aCamera, aWindow);
+		break;
+	default:
+		break;
+	}
+}
 
 void Render::RenderImpl::RenderMapLayer(layer* layer)
 {
-	SDL_Texture* lTex = mPartInst->mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(layer->tileset_of_layer->texture);
+	SDL_Rect lArea;
+	SDL_Texture* lTex = mPartInst->mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(layer->tileset_of_layer->texture, lArea);
 	if (lTex == nullptr)
 	{
 		return;
 	}
 
-	BlitLayer* it = new BlitLayer(lTex,layer);
+	BlitLayer* it = mFrameArena.New<BlitLayer>(lTex,layer);
+	it->tex_area = lArea;
 	it->depth = layer->depth;
-	allQueue.push(it);
+	it->targets_generation = mRenderTargetsGeneration;
+	it->chunk_keep_radius = mChunkKeepRadius;
+	PushCommand(it, RenderQueue::RENDER_GAME, layer->tileset_of_layer->texture);
 }
 
 void Render::RenderImpl::RenderParticleEmitter(ParticleEmitter* layer, RenderQueue aRenderQueue)
 {
-	SDL_Texture* lTex = mPartInst->mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(layer->preset_for_emitter->texture_name);
+	SDL_Rect lArea;
+	SDL_Texture* lTex = mPartInst->mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(layer->preset_for_emitter->texture_name, lArea);
 	if (lTex == nullptr)
 	{
 		return;
 	}
 
-	BlitParticles* it = new BlitParticles(lTex,layer);
+	BlitParticles* it = mFrameArena.New<BlitParticles>(lTex,layer);
+	it->tex_area = lArea;
 	it->depth = layer->depth;
-	GetQueue(aRenderQueue)->push(it);
+	PushCommand(it, aRenderQueue, layer->preset_for_emitter->texture_name);
 }
 
 
 void Render::RenderImpl::RenderMapBackground(TextureID aTexID, int depth, bool repeat_y, float parallax_factor_x, float parallax_factor_y)
 {
-	SDL_Texture* lTex = mPartInst->mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(aTexID);
+	SDL_Rect lArea;
+	SDL_Texture* lTex = mPartInst->mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(aTexID, lArea);
 	if (lTex == nullptr)
 	{
 		return;
 	}
 
-	BlitBackground* it = new BlitBackground(lTex,depth,repeat_y, parallax_factor_x, parallax_factor_y);
-	//order the elements
-	allQueue.push(it);
+	BlitBackground* it = mFrameArena.New<BlitBackground>(lTex,depth,repeat_y, parallax_factor_x, parallax_factor_y);
+	it->on_image = lArea;
+	PushCommand(it, RenderQueue::RENDER_GAME, aTexID);
 }
 
 bool Render::RenderImpl::CleanUp()
 {
 	bool ret = true;
 
+	SDL_DelEventWatch(RenderTargetsResetWatch, this);
 	SDL_DestroyRenderer(renderer);
 
 	//SDL_QuitSubSystem(SDL_INIT_VIDEO);
@@ -203,20 +316,23 @@ void Render::RenderTexture(TextureID aTexID, int x, int y,const RXRect& rect_on_
 		return;
 	}
 
-	SDL_Texture* lTex = mApp.GetImplementation<Textures,Textures::TexturesImpl>()->Get_Texture(aTexID);
+	SDL_Rect lArea;
+	SDL_Texture* lTex = mApp.GetImplementation<Textures,Textures::TexturesImpl>()->Get_Texture(aTexID, lArea);
 	if (lTex == nullptr)
 	{
 		return;
 	}
 
-	BlitTexture* it = new BlitTexture(lTex, SDL_Rect{ rect_on_image.x,rect_on_image.y,rect_on_image.w,rect_on_image.h }, parallax_factor_x, parallax_factor_y);
+	//textures packed in an atlas are offset to their place in the page
+	SDL_Rect lOnImage = { rect_on_image.x + lArea.x,rect_on_image.y + lArea.y,rect_on_image.w,rect_on_image.h };
+	BlitTexture* it = lImpl->mFrameArena.New<BlitTexture>(lTex, lOnImage, parallax_factor_x, parallax_factor_y);
 	it->SetPosition(x, y);
 	it->SetCenter(center_x, center_y);
 	it->depth = depth;
 	it->ignore_camera = aQueue == RenderQueue::RENDER_UI;
 	it->angle = angle;
 
-	lImpl->GetQueue(aQueue)->push(it);
+	lImpl->PushCommand(it, aQueue, aTexID);
 }
 
 void Render::RenderAnimation(Animation& aAnimation, int x, int y, int aDepth, RenderQueue aQueue, float angle, float parallax_factor_x, float parallax_factor_y, int center_x, int center_y)
@@ -238,18 +354,20 @@ void Render::RenderText(const char* text, FontID font, int x, int y, int depth,
 		return;
 	}
 
-	SDL_Texture* lTexture = mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(lFont->font_texture);
+	SDL_Rect lArea;
+	SDL_Texture* lTexture = mApp.GetImplementation<Textures, Textures::TexturesImpl>()->Get_Texture(lFont->font_texture, lArea);
 	if (lTexture == nullptr)
 	{
 		return;
 	}
 
-	BlitItemText* it = new BlitItemText(text, lFont, lTexture);
+	BlitItemText* it = lImpl->mFrameArena.New<BlitItemText>(lImpl->mFrameArena.CopyString(text), lFont, lTexture);
+	it->tex_area = lArea;
 	it->ignore_camera = aQueue == RenderQueue::RENDER_UI || ignore_camera;
 	it->SetPosition(x, y);
 	it->color = { aColor.r, aColor.g, aColor.b, aColor.a };
 	it->depth = depth;
-	lImpl->GetQueue(aQueue)->push(it);
+	lImpl->PushCommand(it, aQueue, lFont->font_texture);
 }
 
 void Render::RenderRect(const RXRect& area, const RXColor& aColor, bool filled, RenderQueue aQueue,int depth , bool ignore_camera)
@@ -261,12 +379,12 @@ void Render::RenderRect(const RXRect& area, const RXColor& aColor, bool filled,
 		return;
 	}
 
-	BlitRect* it = new BlitRect(area, filled);
+	BlitRect* it = lImpl->mFrameArena.New<BlitRect>(area, filled);
 	it->color = aColor;
 	it->ignore_camera = aQueue == RenderQueue::RENDER_UI || ignore_camera;
 	it->depth = depth;
 
-	lImpl->GetQueue(aQueue)->push(it);
+	lImpl->PushCommand(it, aQueue, 0);
 }
 
 void Render::RenderTrail(RXPoint* point_array, int amount, RenderQueue aQueue,bool aIgnoreCamera,int depth, uint8_t r, uint8_t g, uint8_t b)
@@ -278,7 +396,7 @@ void Render::RenderTrail(RXPoint* point_array, int amount, RenderQueue aQueue,bo
 		return;
 	}
 
-	SDL_Point* lPoints = new SDL_Point[amount];
+	SDL_Point* lPoints = lImpl->mFrameArena.NewArray<SDL_Point>(amount);
 
 	for (int i = 0; i < amount; ++i)
 	{
@@ -286,10 +404,10 @@ void Render::RenderTrail(RXPoint* point_array, int amount, RenderQueue aQueue,bo
 		lPoints[i].y = point_array[i].y;
 	}
 
-	BlitTrail* it = new BlitTrail(lPoints,amount,depth);
+	BlitTrail* it = lImpl->mFrameArena.New<BlitTrail>(lPoints,amount,depth);
 	it->color = RXColor{ r,g,b ,255};
 	it->ignore_camera = aQueue == RenderQueue::RENDER_UI || aIgnoreCamera;
-	lImpl->GetQueue(aQueue)->push(it);
+	lImpl->PushCommand(it, aQueue, 0);
 }
 
 void BlitTexture::Blit(Render& aRender, Camera& camera, Window& aWindow)
@@ -332,35 +450,109 @@ void BlitLayer::Blit(Render& aRender, Camera& camera, Window& aWindow)
 {
 	float scale = aWindow.GetScale();
 
-	float para_x = mLayer->parallax_x;
-	float para_y = mLayer->parallax_y;
-	int depth = mLayer->depth;
+	tileset* t = mLayer->tileset_of_layer;
+
+	float tile_w = scale * t->tile_width;
+	float tile_h = scale * t->tile_height;
+	if (tile_w <= 0 || tile_h <= 0)
+	{
+		return;
+	}
+
+	//tile layers move with the camera, their parallax is only used by backgrounds
+	float offset_x = camera.GetCameraXoffset();
+	float offset_y = camera.GetCameraYoffset();
 
-	tileset* t = mLayer->tileset_of_layer;//(*tilesets.begin());
+	//only the tiles that fall inside of the screen are visited
+	RXRect lScreen = camera.GetScreenArea();
+	int first_x = (int)floorf(-offset_x / tile_w);
+	int first_y = (int)floorf(-offset_y / tile_h);
+	int last_x = (int)floorf((lScreen.w - offset_x) / tile_w);
+	int last_y = (int)floorf((lScreen.h - offset_y) / tile_h);
 
-	for (int _y = 0; _y < mLayer->height; ++_y)
+	//the textures of chunks away from the screen are freed, a large map would fill the memory with them
+	mLayer->ClearChunksOutside((int)floorf((float)first_x / TILE_CHUNK_SIZE) - chunk_keep_radius, (int)floorf((float)first_y / TILE_CHUNK_SIZE) - chunk_keep_radius,
+		(int)floorf((float)last_x / TILE_CHUNK_SIZE) + chunk_keep_radius, (int)floorf((float)last_y / TILE_CHUNK_SIZE) + chunk_keep_radius);
+
+	first_x = max(first_x, 0);
+	first_y = max(first_y, 0);
+	last_x = min(last_x, mLayer->width - 1);
+	last_y = min(last_y, mLayer->height - 1);
+
+	if (first_x > last_x || first_y > last_y)
 	{
-		for (int _x = 0; _x < mLayer->width; ++_x)
-		{
-			int i = _y * mLayer->width + _x;
-			//tileset* t = GetTilesetFromId((*it)->data[i]);
-			float worldcoords_x = scale * _x * t->tile_width + camera.GetCameraXoffset();
-			float worldcoords_y = scale * _y * t->tile_height + camera.GetCameraYoffset();
+		return;
+	}
+
+	if (!mLayer->use_chunks)
+	{
+		BlitTiles(aRender, first_x, first_y, last_x, last_y, offset_x, offset_y, tile_w, tile_h);
+		return;
+	}
+
+	float chunk_w = tile_w * TILE_CHUNK_SIZE;
+	float chunk_h = tile_h * TILE_CHUNK_SIZE;
 
-			//App->ren->BlitMapTile(t->texture, _x, _y, GetImageRectFromId((*it)->data[i]), depth, para_x, para_y);
+	for (int _cy = first_y / TILE_CHUNK_SIZE; _cy <= last_y / TILE_CHUNK_SIZE; ++_cy)
+	{
+		for (int _cx = first_x / TILE_CHUNK_SIZE; _cx <= last_x / TILE_CHUNK_SIZE; ++_cx)
+		{
+			tile_chunk& lChunk = mLayer->chunks[_cy * mLayer->chunks_x + _cx];
+			if (lChunk.texture == nullptr || lChunk.dirty || lChunk.baked_generation != targets_generation)
+			{
+				if (!BakeChunk(aRender, lChunk, _cx, _cy))
+				{
+					//the renderer can't cache the layer, fall back to drawing it tile by tile
+					Logger::Console_log(LogLevel::LOG_WARN, "Could not cache tile layer chunks, drawing tiles individually");
+					mLayer->use_chunks = false;
+					mLayer->ClearChunks();
+					BlitTiles(aRender, first_x, first_y, last_x, last_y, offset_x, offset_y, tile_w, tile_h);
+					return;
+				}
+			}
 
+			//edges are computed from the neighbours so consecutive chunks don't leave seams
 			SDL_Rect on_scn;
-			on_scn.x = worldcoords_x;
-			on_scn.y = worldcoords_y;
-			on_scn.w = 48 * scale;
-			on_scn.h = 48 * scale;
+			on_scn.x = _cx * chunk_w + offset_x;
+			on_scn.y = _cy * chunk_h + offset_y;
+			on_scn.w = (int)((_cx + 1) * chunk_w + offset_x) - on_scn.x;
+			on_scn.h = (int)((_cy + 1) * chunk_h + offset_y) - on_scn.y;
 
-			RXRect lRect = { on_scn.x,on_scn.y,on_scn.w,on_scn.h };
-			if (!camera.isOnScreen(lRect, false))
+			aRender.CountDrawCall();
+			if (SDL_RenderCopy(aRender.GetSDL_Renderer(), lChunk.texture, NULL, &on_scn) != 0)
+			{
+				std::string errstr = "Cannot blit to screen. SDL_RenderCopy error: ";
+				errstr += SDL_GetError();
+				Logger::Console_log(LogLevel::LOG_ERROR, errstr.c_str());
+			}
+		}
+	}
+}
+
+void BlitLayer::BlitTiles(Render& aRender, int first_x, int first_y, int last_x, int last_y, float offset_x, float offset_y, float tile_w, float tile_h)
+{
+	tileset* t = mLayer->tileset_of_layer;
+
+	for (int _y = first_y; _y <= last_y; ++_y)
+	{
+		for (int _x = first_x; _x <= last_x; ++_x)
+		{
+			uint id = mLayer->data[_y * mLayer->width + _x];
+			if (id == (uint)-1)
+			{
 				continue;
+			}
+
+			SDL_Rect on_scn;
+			on_scn.x = _x * tile_w + offset_x;
+			on_scn.y = _y * tile_h + offset_y;
+			on_scn.w = tile_w;
+			on_scn.h = tile_h;
+
+			SDL_Rect on_img = GetImageRectFromId(t, id);
 
 			aRender.CountDrawCall();
-			if (SDL_RenderCopyEx(aRender.GetSDL_Renderer(), tex, &GetImageRectFromId(mLayer->tileset_of_layer, mLayer->data[i]), &on_scn, 0, NULL, SDL_FLIP_NONE) != 0)
+			if (SDL_RenderCopyEx(aRender.GetSDL_Renderer(), tex, &on_img, &on_scn, 0, NULL, SDL_FLIP_NONE) != 0)
 			{
 				std::string errstr = "Cannot blit to screen. SDL_RenderCopy error: ";
 				errstr += SDL_GetError();
@@ -368,7 +560,75 @@ void BlitLayer::Blit(Render& aRender, Camera& camera, Window& aWindow)
 			}
 		}
 	}
+}
+
+bool BlitLayer::BakeChunk(Render& aRender, tile_chunk& aChunk, int aChunkX, int aChunkY)
+{
+	SDL_Renderer* lRenderer = aRender.GetSDL_Renderer();
+	tileset* t = mLayer->tileset_of_layer;
+
+	if (aChunk.texture == nullptr)
+	{
+		aChunk.texture = SDL_CreateTexture(lRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, TILE_CHUNK_SIZE * t->tile_width, TILE_CHUNK_SIZE * t->tile_height);
+		if (aChunk.texture == nullptr)
+		{
+			std::string errstr = "Cannot create tile chunk texture. SDL_CreateTexture error: ";
+			errstr += SDL_GetError();
+			Logger::Console_log(LogLevel::LOG_ERROR, errstr.c_str());
+			return false;
+		}
+		SDL_SetTextureBlendMode(aChunk.texture, SDL_BLENDMODE_BLEND);
+		mLayer->baked_chunks.push_back(aChunkY * mLayer->chunks_x + aChunkX);
+	}
+
+	if (SDL_SetRenderTarget(lRenderer, aChunk.texture) != 0)
+	{
+		std::string errstr = "Cannot render to tile chunk texture. SDL_SetRenderTarget error: ";
+		errstr += SDL_GetError();
+		Logger::Console_log(LogLevel::LOG_ERROR, errstr.c_str());
+		return false;
+	}
+
+	Uint8 lR, lG, lB, lA;
+	SDL_GetRenderDrawColor(lRenderer, &lR, &lG, &lB, &lA);
+	SDL_SetRenderDrawColor(lRenderer, 0, 0, 0, 0);
+	SDL_RenderClear(lRenderer);
+
+	//tiles don't overlap, copy them as they are so the chunk keeps the tileset's alpha
+	SDL_BlendMode lTilesetBlend;
+	SDL_GetTextureBlendMode(tex, &lTilesetBlend);
+	SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_NONE);
+
+	int lStartX = aChunkX * TILE_CHUNK_SIZE;
+	int lStartY = aChunkY * TILE_CHUNK_SIZE;
+	int lEndX = min(lStartX + TILE_CHUNK_SIZE, mLayer->width);
+	int lEndY = min(lStartY + TILE_CHUNK_SIZE, mLayer->height);
+
+	for (int _y = lStartY; _y < lEndY; ++_y)
+	{
+		for (int _x = lStartX; _x < lEndX; ++_x)
+		{
+			uint id = mLayer->data[_y * mLayer->width + _x];
+			if (id == (uint)-1)
+			{
+				continue;
+			}
+
+			SDL_Rect on_img = GetImageRectFromId(t, id);
+			SDL_Rect on_chunk = { (_x - lStartX) * t->tile_width, (_y - lStartY) * t->tile_height, t->tile_width, t->tile_height };
+
+			aRender.CountDrawCall();
+			SDL_RenderCopy(lRenderer, tex, &on_img, &on_chunk);
+		}
+	}
+
+	SDL_SetTextureBlendMode(tex, lTilesetBlend);
+	SDL_SetRenderTarget(lRenderer, NULL);
+	SDL_SetRenderDrawColor(lRenderer, lR, lG, lB, lA);
 
+	aChunk.dirty = false;
+	aChunk.baked_generation = targets_generation;
+	return true;
 }
 
 SDL_Rect BlitLayer::GetImageRectFromId(tileset* t, int id)
@@ -377,17 +637,16 @@ SDL_Rect BlitLayer::GetImageRectFromId(tileset* t, int id)
 	SDL_Rect rect;
 	rect.w = t->tile_width;
 	rect.h = t->tile_height;
-	rect.x = ((rect.w) * (id % t->columns));
-	rect.y = ((rect.h) * (id / t->columns));
+	rect.x = ((rect.w) * (id % t->columns)) + tex_area.x;
+	rect.y = ((rect.h) * (id / t->columns)) + tex_area.y;
 
 	return rect;
 }
 
 void BlitBackground::Blit(Render& aRender, Camera& camera, Window& aWindow)
 {
-	int back_w, back_h;
-
-	SDL_QueryTexture(tex, NULL, NULL, &back_w, &back_h);
+	int back_w = on_image.w;
+	int back_h = on_image.h;
 
 	float scale = aWindow.GetScale();
 	//calculate camera tile
@@ -453,7 +712,7 @@ void BlitBackground::Blit(Render& aRender, Camera& camera, Window& aWindow)
 			rect.h *= scale;
 
 			aRender.CountDrawCall();
-			if (SDL_RenderCopyEx(aRender.GetSDL_Renderer(), tex, NULL, &rect, 0, NULL, SDL_FLIP_NONE) != 0)
+			if (SDL_RenderCopyEx(aRender.GetSDL_Renderer(), tex, &on_image, &rect, 0, NULL, SDL_FLIP_NONE) != 0)
 			{
 				std::string errstr = "Cannot blit to screen. SDL_RenderCopy error: ";
 				errstr += SDL_GetError();
@@ -524,8 +783,6 @@ void BlitTrail::Blit(Render& aRender, Camera& camera, Window& aWindow)
 	SDL_SetRenderDrawColor(aRender.GetSDL_Renderer(), color.r, color.g, color.b, 255);// it's a debug feature so it'll have max visibility
 	int result = SDL_RenderDrawLines(aRender.GetSDL_Renderer(), points, amount);
 
-	delete points;
-
 	if (result != 0)
 	{
 		std::string errstr = "Cannot draw trail to screen. SDL_RenderFillRect error: ";
@@ -556,7 +813,7 @@ void BlitParticles::Blit(Render& aRender, Camera& camera, Window& aWindow)
 			rect.h *= scale;
 
 			RXRect* lRecFromEmitter = lEmmitter->particles[i]->area_in_texture;
-			SDL_Rect lRectInText = {lRecFromEmitter->x, lRecFromEmitter->y, lRecFromEmitter->w, lRecFromEmitter->h};
+			SDL_Rect lRectInText = {lRecFromEmitter->x + tex_area.x, lRecFromEmitter->y + tex_area.y, lRecFromEmitter->w, lRecFromEmitter->h};
 
 			RXRect lRect = { rect.x,rect.y,rect.w,rect.h };
 			if (!camera.isOnScreen(lRect, false))
@@ -593,7 +850,7 @@ void BlitItemText::Blit(Render& aRender, Camera& camera, Window& aWindow)
 	if (font_used == nullptr)
 		return;
 
-	for (int i = 0; i < mText.size(); ++i)
+	for (int i = 0; mText[i] != '\0'; ++i)
 	{
 		if(mText[i] == '\n')
 		{
@@ -615,8 +872,9 @@ void BlitItemText::Blit(Render& aRender, Camera& camera, Window& aWindow)
 			if (!camera.isOnScreen(lRect,false))
 				continue;
 
+			SDL_Rect on_image = { mappedRect->x + tex_area.x, mappedRect->y + tex_area.y, mappedRect->w, mappedRect->h };
 			aRender.CountDrawCall();
-			if (SDL_RenderCopyEx(aRender.GetSDL_Renderer(), lFontTexture, mappedRect, &on_screen, 0, NULL, SDL_FLIP_NONE) != 0)
+			if (SDL_RenderCopyEx(aRender.GetSDL_Renderer(), lFontTexture, &on_image, &on_screen, 0, NULL, SDL_FLIP_NONE) != 0)
 			{
 				std::string errstr = "Cannot blit to screen. SDL_RenderCopy error: ";
 				errstr += SDL_GetError();
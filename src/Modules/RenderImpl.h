@@ -5,10 +5,28 @@
 #include "PartImpl.h"
 #include "SDL/include/SDL.h"
 #include "SceneControllerImpl.h"
+#include "FrameArena.h"
 
 class ParticleEmitter;
 class Font;
 
+//chunks of tile layers kept around the ones on screen, the rest give their texture back
+#define TILE_CHUNK_DEFAULT_KEEP_RADIUS 1
+
+//bits used by each field of the render command sort key, from most to least significant
+#define SORTKEY_QUEUE_BITS 2
+#define SORTKEY_DEPTH_BITS 16
+#define SORTKEY_TEXTURE_BITS 20
+#define SORTKEY_ORDER_BITS 26
+
+//a render command as stored in the frame's command list
+struct RenderCommand
+{
+	//queue, depth, texture and submission order packed so that sorting by it gives the draw order
+	uint64 key;
+	BlitItem* item;
+};
+
 class Render::RenderImpl : public Part::Part_Impl
 {
 public:
@@ -21,6 +39,8 @@ public:
 	void RenderMapBackground(TextureID aTexID, int depth, bool repeat_y, float parallax_factor_x = 1, float parallax_factor_y = 1);
 	void RenderMapLayer(layer* layer);
 	void RenderParticleEmitter(ParticleEmitter* emitter, RenderQueue aRenderQueue);
+	//called when the renderer lost the contents of its target textures
+	void InvalidateRenderTargets() { ++mRenderTargetsGeneration; }
 
 protected:
 	bool Init();
@@ -31,16 +51,24 @@ protected:
 	bool CreateConfig(pugi::xml_node& config_node);
 
 private:
-	std::priority_queue<BlitItem*, std::vector<BlitItem*>, Comparer>* GetQueue(RenderQueue aQueue);
+	void PushCommand(BlitItem* aItem, RenderQueue aQueue, TextureID aTexture);
+	void SortCommands();
+	void BlitItemByType(BlitItem* aItem, Camera& aCamera, Window& aWindow);
 
 	int		width;
 	int		height;
 	int		scale;
 	int		mDrawCallsLastFrame;
+	uint	mRenderTargetsGeneration = 1;
+	int		mChunkKeepRadius = TILE_CHUNK_DEFAULT_KEEP_RADIUS;
+
+	//commands of every queue for this frame, ordered by SortCommands before drawing
+	std::vector<RenderCommand> mCommands;
+	//scratch buffer for the radix sort
+	std::vector<RenderCommand> mSortBuffer;
 
-	std::priority_queue<BlitItem*, std::vector<BlitItem*>, Comparer> allQueue;
-	std::priority_queue<BlitItem*, std::vector<BlitItem*>, Comparer> uiQueue;
-	std::priority_queue<BlitItem*, std::vector<BlitItem*>, Comparer> debugQueue;
+	//storage for all of the render commands of the frame
+	FrameArena mFrameArena;
 
 	SDL_Renderer*	renderer;
 	SDL_Color		background;
@@ -54,11 +82,14 @@ class BlitItemText : public BlitItem
 {
 public:
 	BlitItemText(const char* aText, Font* aFontUsed, SDL_Texture* aTexture) 
-		: mText(std::string(aText)), font_used(aFontUsed), lFontTexture(aTexture) {};
+		: mText(aText), font_used(aFontUsed), lFontTexture(aTexture) { type = BLIT_TEXT; };
 
-	std::string mText;
+	//copy of the text that lives in the frame arena
+	const char* mText;
 	Font* font_used;
 	SDL_Texture* lFontTexture;
+	//area of the texture that holds the font, glyphs are relative to it
+	SDL_Rect tex_area;
 	void Blit(Render& aRender, Camera& camera, Window& aWindow);
 };
 
@@ -66,7 +97,7 @@ class BlitTexture : public BlitItem
 {
 public:
 	BlitTexture(SDL_Texture* aTex, SDL_Rect& aOnImage, float aParallax_x, float aParallax_y) 
-		: tex(aTex), on_image(aOnImage), parallax_x(aParallax_x), parallax_y(aParallax_y) {};
+		: tex(aTex), on_image(aOnImage), parallax_x(aParallax_x), parallax_y(aParallax_y) { type = BLIT_TEXTURE; };
 
 	SDL_Texture* tex;
 	SDL_Rect on_image;
@@ -79,12 +110,20 @@ public:
 class BlitLayer : public BlitItem
 {
 public:
-	BlitLayer(SDL_Texture* aTexture, layer* aLayer) : tex(aTexture), mLayer(aLayer) {};
+	BlitLayer(SDL_Texture* aTexture, layer* aLayer) : tex(aTexture), mLayer(aLayer) { type = BLIT_LAYER; };
 
 	layer* mLayer;
 	SDL_Texture* tex;
+	//area of the texture that holds the tileset
+	SDL_Rect tex_area;
+	//chunks baked on an older generation of render targets are rendered again
+	uint targets_generation;
+	//chunks further than this from the screen are freed
+	int chunk_keep_radius;
 
 	void Blit(Render& aRender, Camera& camera, Window& aWindow);
+	void BlitTiles(Render& aRender, int first_x, int first_y, int last_x, int last_y, float offset_x, float offset_y, float tile_w, float tile_h);
+	bool BakeChunk(Render& aRender, tile_chunk& aChunk, int aChunkX, int aChunkY);
 
 	SDL_Rect GetImageRectFromId(tileset* t, int id);
 
@@ -96,6 +135,7 @@ class BlitBackground : public BlitTexture
 public:
 	BlitBackground(SDL_Texture* aTexID, int aDepth, bool aRepeat_y, float aParallax_factor_x, float aParallax_factor_y) 
 		: BlitTexture(aTexID, SDL_Rect{ 0,0,0,0 }, aParallax_factor_x, aParallax_factor_y), repeat_y(aRepeat_y) {
+		type = BLIT_BACKGROUND;
 		depth = aDepth;
 	};
 	bool repeat_y;
@@ -105,10 +145,12 @@ public:
 class BlitParticles : public BlitItem
 {
 public:
-	BlitParticles(SDL_Texture* aTexture, ParticleEmitter* aEmmitter) : tex(aTexture), lEmmitter(aEmmitter) {};
+	BlitParticles(SDL_Texture* aTexture, ParticleEmitter* aEmmitter) : tex(aTexture), lEmmitter(aEmmitter) { type = BLIT_PARTICLES; };
 
 	ParticleEmitter* lEmmitter;
 	SDL_Texture* tex;
+	//area of the texture that holds the particle image
+	SDL_Rect tex_area;
 
 	void Blit(Render& aRender, Camera& camera, Window& aWindow);
 };
@@ -117,6 +159,7 @@ class BlitRect : public BlitItem
 {
 public:
 	BlitRect(const RXRect& aRect, bool aFilled) : w(aRect.w), h(aRect.h), filled(aFilled) {
+		type = BLIT_RECT;
 		x = aRect.x;
 		y = aRect.y;
 	}
@@ -131,8 +174,9 @@ public:
 class BlitTrail : public BlitItem
 {
 public:
-	BlitTrail(SDL_Point* aPoint, int aAmount, int aDepth) : points(aPoint), amount(aAmount) { depth = aDepth; }
+	BlitTrail(SDL_Point* aPoint, int aAmount, int aDepth) : points(aPoint), amount(aAmount) { type = BLIT_TRAIL; depth = aDepth; }
 
+	//points are allocated in the frame arena
 	SDL_Point* points;
 	int amount;
 	void Blit(Render& aRender, Camera& camera, Window& aWindow);
@@ -21,9 +21,35 @@
 #include "RenderImpl.h"
 #include "ParticlesImpl.h"
 #include "ObjectManagerImpl.h"
+#include "MapFormat.h"
+#include "TileDecoder.h"
 
 #include "Utils/Utils.h"
 
+#include <sys/stat.h>
+
+//-1 if the file can't be found
+static long long GetFileSize(const char* aPath)
+{
+	struct stat lStat;
+	if (aPath[0] == '\0' || stat(aPath, &lStat) != 0)
+	{
+		return -1;
+	}
+	return lStat.st_size;
+}
+
+//mtime only has whole seconds, a file written in the second it was read counts as changed
+static bool FileChangedSince(const char* aPath, time_t aTime, long long aSize)
+{
+	struct stat lStat;
+	if (aPath[0] == '\0' || stat(aPath, &lStat) != 0)
+	{
+		return aSize != -1;
+	}
+	return lStat.st_mtime >= aTime || (long long)lStat.st_size != aSize;
+}
+
 SceneController::SceneController(EngineAPI& aAPI):Part("SceneController",aAPI)
 {
 	mPartFuncts = new SceneControllerImpl(this);
@@ -31,6 +57,117 @@ SceneController::SceneController(EngineAPI& aAPI):Part("SceneController",aAPI)
 
 #pragma region IMPLEMENTATION
 
+void layer::ClearChunks()
+{
+	for (std::vector<tile_chunk>::iterator it = chunks.begin(); it != chunks.end(); ++it)
+	{
+		if ((*it).texture != nullptr)
+		{
+			SDL_DestroyTexture((*it).texture);
+			(*it).texture = nullptr;
+		}
+		(*it).dirty = true;
+	}
+	baked_chunks.clear();
+}
+
+void layer::ClearChunks(int aFirstX, int aFirstY, int aLastX, int aLastY)
+{
+	int lFirstX = max(aFirstX, 0) / TILE_CHUNK_SIZE;
+	int lFirstY = max(aFirstY, 0) / TILE_CHUNK_SIZE;
+	int lLastX = min(aLastX, width - 1) / TILE_CHUNK_SIZE;
+	int lLastY = min(aLastY, height - 1) / TILE_CHUNK_SIZE;
+
+	for (int y = lFirstY; y <= lLastY; ++y)
+	{
+		for (int x = lFirstX; x <= lLastX; ++x)
+		{
+			tile_chunk& lChunk = chunks[y * chunks_x + x];
+			if (lChunk.texture != nullptr)
+			{
+				SDL_DestroyTexture(lChunk.texture);
+				lChunk.texture = nullptr;
+			}
+			lChunk.dirty = true;
+		}
+	}
+}
+
+void layer::ClearChunksOutside(int aFirstX, int aFirstY, int aLastX, int aLastY)
+{
+	for (uint i = 0; i < baked_chunks.size();)
+	{
+		int lX = baked_chunks[i] % chunks_x;
+		int lY = baked_chunks[i] / chunks_x;
+		bool lFar = lX < aFirstX || lX > aLastX || lY < aFirstY || lY > aLastY;
+		if (lFar)
+		{
+			ClearChunks(lX * TILE_CHUNK_SIZE, lY * TILE_CHUNK_SIZE, (lX + 1) * TILE_CHUNK_SIZE - 1, (lY + 1) * TILE_CHUNK_SIZE - 1);
+		}
+
+		//chunks freed by a range clear are dropped here too
+		if (lFar || chunks[baked_chunks[i]].texture == nullptr)
+		{
+			baked_chunks[i] = baked_chunks.back();
+			baked_chunks.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+bool SceneController::SceneControllerImpl::LoadConfig(pugi::xml_node& config_node)
+{
+	pugi::xml_node streaming_node = config_node.child("streaming");
+	mStreamRegionSize = streaming_node.attribute("region_size").as_int(STREAMING_DEFAULT_REGION_SIZE);
+	mStreamRadius = streaming_node.attribute("radius").as_int(STREAMING_DEFAULT_RADIUS);
+	mStreamRegionsPerFrame = streaming_node.attribute("regions_per_frame").as_int(STREAMING_DEFAULT_REGIONS_PER_FRAME);
+
+	//regions cover whole chunks so unloading one frees its chunks
+	mStreamRegionSize = max(TILE_CHUNK_SIZE, (mStreamRegionSize + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE * TILE_CHUNK_SIZE);
+	mStreamRadius = max(mStreamRadius, 0);
+	mStreamRegionsPerFrame = max(mStreamRegionsPerFrame, 1);
+
+	pugi::xml_node cache_node = config_node.child("map_cache");
+	mMapCacheSize = cache_node.attribute("size").as_int(MAP_CACHE_DEFAULT_SIZE);
+	mMapCacheMaxBytes = cache_node.attribute("max_mb").as_ullong(MAP_CACHE_DEFAULT_MAX_MB) * 1024 * 1024;
+	return true;
+}
+
+bool SceneController::SceneControllerImpl::CreateConfig(pugi::xml_node& config_node)
+{
+	pugi::xml_node streaming_node = config_node.append_child("streaming");
+	streaming_node.append_attribute("region_size") = STREAMING_DEFAULT_REGION_SIZE;
+	streaming_node.append_attribute("radius") = STREAMING_DEFAULT_RADIUS;
+	streaming_node.append_attribute("regions_per_frame") = STREAMING_DEFAULT_REGIONS_PER_FRAME;
+
+	pugi::xml_node cache_node = config_node.append_child("map_cache");
+	cache_node.append_attribute("size") = MAP_CACHE_DEFAULT_SIZE;
+	cache_node.append_attribute("max_mb") = MAP_CACHE_DEFAULT_MAX_MB;
+	return true;
+}
+
+bool SceneController::SceneControllerImpl::PreLoop()
+{
+	//the objects of the old map are queued for drawing during the Loop of the parts before this one
+	if (lMapToLoad != "")
+	{
+		LoadMapExecute(lMapToLoad.c_str());
+		lMapToLoad = "";
+	}
+
+	CollectPreloadedMaps();
+
+	if (mLoadState != MAP_LOAD_IDLE)
+	{
+		UpdateAsyncLoad();
+	}
+
+	return true;
+}
+
 bool SceneController::SceneControllerImpl::Loop(float dt)
 {
 	bool ret = true;
@@ -40,10 +177,9 @@ bool SceneController::SceneControllerImpl::Loop(float dt)
 		SceneFunction();
 	}
 
-	if (lMapToLoad != "")
+	if (mStreaming)
 	{
-		LoadMapExecute(lMapToLoad.c_str());
-		lMapToLoad = "";
+		UpdateStreaming();
 	}
 
 	for (std::vector<background_texture*>::iterator it = active_backgrounds.begin(); it != active_backgrounds.end(); it++)
@@ -59,170 +195,1128 @@ bool SceneController::SceneControllerImpl::Loop(float dt)
 	return ret;
 }
 
-bool SceneController::SceneControllerImpl::CleanUp()
-{
-	bool ret = true;
-	mPartInst->CleanMap();
-	mPartInst->mApp.GetModule<ObjectManager>().Clearphysics();
-	return ret;
+bool SceneController::SceneControllerImpl::CleanUp()
+{
+	bool ret = true;
+	DiscardAsyncLoad();
+	mPreloader.Stop();
+	mPartInst->CleanMap();
+	mPartInst->mApp.GetModule<ObjectManager>().Clearphysics();
+	ClearMapCache();
+	return ret;
+}
+
+bool SceneController::SceneControllerImpl::LoadTilesets(pugi::xml_node & node, staged_map& aMap)
+{
+	pugi::xml_node imagenode = node.child("image");
+
+	staged_tileset lSet;
+	lSet.firstgid = node.attribute("firstgid").as_int();
+	lSet.tile_width = node.attribute("tilewidth").as_int();
+	lSet.tile_height = node.attribute("tileheight").as_int();
+	lSet.columns = node.attribute("columns").as_int();
+	lSet.total_tiles = node.attribute("tilecount").as_int();
+	lSet.image = imagenode.attribute("source").as_string();
+	aMap.tilesets.push_back(lSet);
+
+	return true;
+}
+
+void SceneController::SceneControllerImpl::AddTileset(const staged_tileset& aTileset, const char* aMapFolder)
+{
+	tileset* set = new tileset(aTileset.firstgid, aTileset.tile_width, aTileset.tile_height, aTileset.columns, aTileset.total_tiles);
+
+	std::string base_folder = aMapFolder;
+	base_folder += aTileset.image;
+
+	//load this texture, after a background load it is already decoded
+	set->texture = mPartInst->mApp.GetModule<Textures>().Load_Texture(base_folder.c_str());
+	tilesets.push_back(set);
+}
+
+bool SceneController::SceneControllerImpl::LoadBackgroundImage(pugi::xml_node& node, staged_map& aMap)
+{
+	staged_background lBack;
+	lBack.depth = 20;
+	lBack.parallax_x = 1;
+	lBack.parallax_y = 1;
+	lBack.repeat_y = true;
+
+	pugi::xml_node iterator;
+	pugi::xml_node properties_node = node.child("properties");
+	for (iterator = properties_node.first_child(); iterator; iterator = iterator.next_sibling())
+	{
+		std::string temp = iterator.attribute("name").as_string();
+		if (temp == "depth")
+		{
+			lBack.depth = iterator.attribute("value").as_int(20);
+		}
+		else if (temp == "parallax_x")
+		{
+			lBack.parallax_x = iterator.attribute("value").as_float(1);
+		}
+		else if (temp == "parallax_y")
+		{
+			lBack.parallax_y = iterator.attribute("value").as_float(1);
+		}
+		else if (temp == "repeat_y")
+		{
+			lBack.repeat_y = iterator.attribute("value").as_bool(true);
+		}
+	}
+
+	pugi::xml_node imagenode = node.child("image");
+	lBack.image = imagenode.attribute("source").as_string();
+	aMap.backgrounds.push_back(lBack);
+
+	return true;
+}
+
+void SceneController::SceneControllerImpl::AddBackground(const staged_background& aBackground, const char* aMapFolder)
+{
+	std::string base_folder = aMapFolder;
+	base_folder += aBackground.image;
+
+	//load this texture
+	TextureID texture = mPartInst->mApp.GetModule<Textures>().Load_Texture(base_folder.c_str());
+
+	background_texture* back = new background_texture(texture, aBackground.parallax_x, aBackground.parallax_y, aBackground.depth, aBackground.image.c_str(), aBackground.repeat_y);
+	active_backgrounds.push_back(back);
+}
+
+bool SceneController::SceneControllerImpl::LoadMapExecute(const char* filename)
+{
+	//a map loading in the background would replace this one when ready
+	DiscardAsyncLoad();
+
+	std::stringstream lStr;
+	lStr << "Loading map from: " << filename;
+	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+
+	//maps visited or preloaded before don't need their files
+	staged_map* lMap = TakeCachedMap(filename);
+	if (lMap == nullptr)
+	{
+		lMap = new staged_map();
+		bool lParsed = ParseMap(filename, *lMap, nullptr);
+		for (std::vector<std::string>::iterator it = lMap->warnings.begin(); it != lMap->warnings.end(); ++it)
+		{
+			Logger::Console_log(LogLevel::LOG_WARN, (*it).c_str());
+		}
+		if (!lParsed)
+		{
+			Logger::Console_log(LogLevel::LOG_ERROR, lMap->error.c_str());
+			delete lMap;
+			return false;
+		}
+	}
+
+	ApplyStagedMap(*lMap, mMapCacheSize > 0);
+	CacheMap(filename, lMap);
+	return true;
+}
+
+bool SceneController::SceneControllerImpl::ParseMap(const char* filename, staged_map& aMap, std::atomic<int>* aProgress)
+{
+	//taken before reading anything so a file saved while it is read counts as changed
+	time_t lParseTime = time(nullptr);
+
+	std::string lCompiled = FindCompiledMap(filename, aMap);
+	if (lCompiled != "")
+	{
+		if (LoadCompiledMap(lCompiled.c_str(), aMap))
+		{
+			if (aProgress != nullptr)
+			{
+				*aProgress = MAP_LOAD_PARSED_PROGRESS;
+			}
+			aMap.parse_time = lParseTime;
+			aMap.source_size = GetFileSize(filename);
+			aMap.compiled_size = GetFileSize(aMap.file_path.c_str());
+			return true;
+		}
+		if (lCompiled == filename)
+		{
+			return false;
+		}
+
+		//whatever was read before the error is thrown away
+		std::vector<std::string> lWarnings = aMap.warnings;
+		lWarnings.push_back(aMap.error + ", loading the xml instead");
+		aMap.Clear();
+		aMap.warnings = lWarnings;
+	}
+
+	if (!LoadXmlMap(filename, aMap, aProgress))
+	{
+		return false;
+	}
+	aMap.parse_time = lParseTime;
+	aMap.source_size = GetFileSize(filename);
+	return true;
+}
+
+bool SceneController::SceneControllerImpl::LoadXmlMap(const char* filename, staged_map& aMap, std::atomic<int>* aProgress)
+{
+	pugi::xml_document	map_file;
+	pugi::xml_node map_node;
+	pugi::xml_parse_result result = map_file.load_file(filename);
+
+	if (result == NULL)
+	{
+		aMap.error = "couldn't find map ";
+		aMap.error += filename;
+		return false;
+	}
+
+	//start!
+	map_node = map_file.child("map");
+	pugi::xml_node iterator;
+
+	aMap.folder = GetDirectoryFromPath(filename);
+
+	//reading the file is about half of the parsing, the other half goes over its elements
+	int lElementCount = 0;
+	int lElement = 0;
+	for (iterator = map_node.first_child(); iterator; iterator = iterator.next_sibling())
+	{
+		++lElementCount;
+	}
+	if (aProgress != nullptr)
+	{
+		*aProgress = MAP_LOAD_PARSED_PROGRESS / 2;
+	}
+
+	pugi::xml_node layer_node = map_node.first_child();
+	for (iterator = layer_node; iterator; iterator = iterator.next_sibling())
+	{
+		std::string iterator_name = iterator.name();
+		if (iterator_name == "tileset")
+		{
+			LoadTilesets(iterator, aMap);
+		}
+		if(iterator_name == "imagelayer")
+		{
+			LoadBackgroundImage(iterator, aMap);
+		}
+		if (iterator_name == "objectgroup")
+		{
+			bool isWallLayer = false;
+			pugi::xml_node lProperties = iterator.child("properties");
+
+			pugi::xml_node iterator_prop;
+			for (iterator_prop = lProperties.first_child(); iterator_prop; iterator_prop = iterator_prop.next_sibling())
+			{
+				pugi::xml_attribute lName = iterator_prop.attribute("name");
+				if (std::strcmp(lName.value(), "isWallLayer") == 0)
+				{
+					isWallLayer = iterator_prop.attribute("value").as_bool(false);
+				}
+			}
+			if(isWallLayer)
+			{
+				LoadWalls(iterator, aMap);
+			}
+			else
+			{
+				LoadObjects(iterator, aMap);
+			}
+		}
+		if (iterator_name == "layer")
+		{
+			if (!LoadTiles(iterator, aMap))
+			{
+				return false;
+			}
+		}
+		if (iterator_name == "properties")
+		{
+			LoadMapProperties(iterator, aMap);
+		}
+
+		if (aProgress != nullptr)
+		{
+			*aProgress = MAP_LOAD_PARSED_PROGRESS / 2 + (MAP_LOAD_PARSED_PROGRESS / 2) * ++lElement / lElementCount;
+		}
+	}
+
+	return true;
+}
+
+std::string SceneController::SceneControllerImpl::FindCompiledMap(const char* filename, staged_map& aMap)
+{
+	std::string lPath = filename;
+	size_t lExtLength = strlen(MAP_FILE_EXTENSION);
+	if (lPath.size() >= lExtLength && lPath.compare(lPath.size() - lExtLength, lExtLength, MAP_FILE_EXTENSION) == 0)
+	{
+		return lPath;
+	}
+
+	//a compiled map next to the xml one is used as long as it is not older than it
+	size_t lDot = lPath.find_last_of('.');
+	size_t lSlash = lPath.find_last_of("/\\");
+	std::string lCompiled = lPath.substr(0, (lDot != std::string::npos && (lSlash == std::string::npos || lDot > lSlash)) ? lDot : lPath.size()) + MAP_FILE_EXTENSION;
+
+	struct stat lXmlStat;
+	struct stat lCompiledStat;
+	if (stat(lCompiled.c_str(), &lCompiledStat) != 0)
+	{
+		return "";
+	}
+	if (stat(filename, &lXmlStat) == 0 && lXmlStat.st_mtime > lCompiledStat.st_mtime)
+	{
+		aMap.warnings.push_back("Compiled map is older than the xml, loading the xml");
+		return "";
+	}
+	return lCompiled;
+}
+
+bool SceneController::SceneControllerImpl::LoadCompiledMap(const char* filename, staged_map& aMap)
+{
+	if (!aMap.file.Open(filename))
+	{
+		aMap.error = "couldn't open compiled map ";
+		aMap.error += filename;
+		return false;
+	}
+
+	aMap.file_path = filename;
+	const char* lData = aMap.file.GetData();
+	unsigned long long lSize = aMap.file.GetSize();
+	const map_file_header* lHeader = (const map_file_header*)lData;
+	if (lSize < sizeof(map_file_header) || lHeader->magic != MAP_FILE_MAGIC || lHeader->version != MAP_FILE_VERSION || lHeader->file_size != lSize)
+	{
+		aMap.error = "wrong format or version on compiled map ";
+		aMap.error += filename;
+		return false;
+	}
+
+	//every section has to be inside of the file before anything is read from it
+	auto lFits = [lSize](unsigned long long aOffset, unsigned long long aCount, unsigned long long aRecordSize)
+	{
+		return aOffset % 4 == 0 && aOffset + aCount * aRecordSize <= lSize;
+	};
+	const char* lStrings = lData + lHeader->strings_offset;
+	if (!lFits(lHeader->tilesets_offset, lHeader->tileset_count, sizeof(map_file_tileset))
+		|| !lFits(lHeader->layers_offset, lHeader->layer_count, sizeof(map_file_layer))
+		|| !lFits(lHeader->backgrounds_offset, lHeader->background_count, sizeof(map_file_background))
+		|| !lFits(lHeader->walls_offset, lHeader->wall_count, sizeof(map_file_wall))
+		|| !lFits(lHeader->objects_offset, lHeader->object_count, sizeof(map_file_object))
+		|| !lFits(lHeader->properties_offset, lHeader->property_count, sizeof(map_file_property))
+		|| !lFits(lHeader->strings_offset, lHeader->strings_size, 1)
+		|| lHeader->strings_size == 0 || lStrings[lHeader->strings_size - 1] != '\0'
+		|| (unsigned long long)lHeader->map_property_first + lHeader->map_property_count > lHeader->property_count)
+	{
+		aMap.error = "corrupted compiled map ";
+		aMap.error += filename;
+		return false;
+	}
+
+	uint lStringsSize = lHeader->strings_size;
+	auto lString = [lStrings, lStringsSize](uint aOffset) { return aOffset < lStringsSize ? lStrings + aOffset : ""; };
+	const map_file_property* lProperties = (const map_file_property*)(lData + lHeader->properties_offset);
+
+	aMap.folder = GetDirectoryFromPath(filename);
+
+	for (uint i = lHeader->map_property_first; i < lHeader->map_property_first + lHeader->map_property_count; ++i)
+	{
+		aMap.properties.push_back(std::make_pair(std::string(lString(lProperties[i].name)), (int)lProperties[i].num_value));
+	}
+
+	const map_file_tileset* lTilesets = (const map_file_tileset*)(lData + lHeader->tilesets_offset);
+	for (uint i = 0; i < lHeader->tileset_count; ++i)
+	{
+		const map_file_tileset& lSet = lTilesets[i];
+		staged_tileset lStaged = { lSet.firstgid, lSet.tile_width, lSet.tile_height, lSet.columns, lSet.total_tiles, lString(lSet.image) };
+		aMap.tilesets.push_back(lStaged);
+	}
+
+	const map_file_background* lBackgrounds = (const map_file_background*)(lData + lHeader->backgrounds_offset);
+	for (uint i = 0; i < lHeader->background_count; ++i)
+	{
+		const map_file_background& lBack = lBackgrounds[i];
+		staged_background lStaged = { lString(lBack.image), lBack.parallax_x, lBack.parallax_y, lBack.depth, lBack.repeat_y != 0 };
+		aMap.backgrounds.push_back(lStaged);
+	}
+
+	const map_file_layer* lLayers = (const map_file_layer*)(lData + lHeader->layers_offset);
+	for (uint i = 0; i < lHeader->layer_count; ++i)
+	{
+		const map_file_layer& lLayer = lLayers[i];
+		if (lLayer.width <= 0 || lLayer.height <= 0 || lLayer.tileset >= aMap.tilesets.size()
+			|| !lFits(lLayer.data_offset, (unsigned long long)lLayer.width * lLayer.height, sizeof(uint)))
+		{
+			aMap.error = "corrupted layer in compiled map";
+			return false;
+		}
+
+		//the tiles are used from the mapped file, changing one only copies its page
+		staged_layer lStaged = { (uint*)(aMap.file.GetData() + lLayer.data_offset), false, lLayer.width, lLayer.height,
+			lLayer.parallax_x, lLayer.parallax_y, lLayer.depth, lLayer.tileset };
+		aMap.layers.push_back(lStaged);
+
+		aMap.room_w = lLayer.width;
+		aMap.room_h = lLayer.height;
+	}
+
+	const map_file_wall* lWalls = (const map_file_wall*)(lData + lHeader->walls_offset);
+	for (uint i = 0; i < lHeader->wall_count; ++i)
+	{
+		RXRect newwall = { lWalls[i].x, lWalls[i].y, lWalls[i].w, lWalls[i].h };
+		aMap.walls.push_back(newwall);
+	}
+
+	const map_file_object* lObjects = (const map_file_object*)(lData + lHeader->objects_offset);
+	aMap.objects.reserve(lHeader->object_count);
+	for (uint i = 0; i < lHeader->object_count; ++i)
+	{
+		const map_file_object& lObject = lObjects[i];
+		if ((unsigned long long)lObject.property_first + lObject.property_count > lHeader->property_count)
+		{
+			aMap.error = "corrupted object in compiled map";
+			return false;
+		}
+
+		staged_object lStaged;
+		lStaged.x = lObject.x;
+		lStaged.y = lObject.y;
+		lStaged.w = lObject.w;
+		lStaged.h = lObject.h;
+		lStaged.type = lString(lObject.type);
+		for (uint j = lObject.property_first; j < lObject.property_first + lObject.property_count; ++j)
+		{
+			ObjectProperty lObjProp = ObjectProperty();
+			lObjProp.name = lString(lProperties[j].name);
+			switch (lProperties[j].type)
+			{
+			case MAP_PROPERTY_BOOL:
+				lObjProp.bool_value = lProperties[j].bool_value != 0;
+				break;
+			case MAP_PROPERTY_FLOAT:
+			case MAP_PROPERTY_INT:
+				lObjProp.num_value = lProperties[j].num_value;
+				break;
+			case MAP_PROPERTY_STRING:
+				lObjProp.str_value = lString(lProperties[j].str_value);
+				break;
+			}
+			lStaged.properties.push_back(lObjProp);
+		}
+		aMap.objects.push_back(lStaged);
+	}
+
+	return true;
+}
+
+void SceneController::SceneControllerImpl::ApplyStagedMap(staged_map& aMap, bool aKeep)
+{
+	mPartInst->CleanMap();
+	mPartInst->mApp.GetModule<ObjectManager>().Clearphysics();
+	mPartInst->mApp.GetImplementation<Particles,Particles::ParticlesImpl>()->ClearParticles();
+
+	//the layers of a compiled map keep pointing inside of the file, a kept map maps it again for the scene
+	bool lCopyTiles = false;
+	if (!aKeep)
+	{
+		mMapFile.Swap(aMap.file);
+	}
+	else if (aMap.file.IsOpen())
+	{
+		if (!mMapFile.Open(aMap.file_path.c_str()) || mMapFile.GetSize() != aMap.file.GetSize())
+		{
+			mMapFile.Close();
+			lCopyTiles = true;
+		}
+	}
+
+	for (std::vector<std::pair<std::string, int>>::iterator it = aMap.properties.begin(); it != aMap.properties.end(); ++it)
+	{
+		ApplyMapProperty((*it).first, (*it).second);
+	}
+
+	for (std::vector<staged_tileset>::iterator it = aMap.tilesets.begin(); it != aMap.tilesets.end(); ++it)
+	{
+		AddTileset(*it, aMap.folder.c_str());
+	}
+
+	for (std::vector<staged_background>::iterator it = aMap.backgrounds.begin(); it != aMap.backgrounds.end(); ++it)
+	{
+		AddBackground(*it, aMap.folder.c_str());
+	}
+
+	for (std::vector<staged_layer>::iterator it = aMap.layers.begin(); it != aMap.layers.end(); ++it)
+	{
+		int lSize = (*it).width * (*it).height;
+		uint* lData = (*it).data;
+		bool lOwnsData = (*it).owns_data;
+		if (aKeep)
+		{
+			//the scene can change its tiles, the kept map can't see that
+			if (lOwnsData || lCopyTiles)
+			{
+				lData = new uint[lSize];
+				memcpy(lData, (*it).data, lSize * sizeof(uint));
+				lOwnsData = true;
+			}
+			else
+			{
+				lData = (uint*)(mMapFile.GetData() + ((const char*)(*it).data - aMap.file.GetData()));
+			}
+		}
+		else
+		{
+			//the tiles belong to the layer now
+			(*it).data = nullptr;
+			(*it).owns_data = false;
+		}
+
+		layer* new_layer = new layer(tilesets[(*it).tileset], lData, (*it).width, (*it).height, (*it).parallax_x, (*it).parallax_y, (*it).depth, lSize);
+		new_layer->owns_data = lOwnsData;
+		layers.push_back(new_layer);
+	}
+	room_w = aMap.room_w;
+	room_h = aMap.room_h;
+
+	//set by the "streaming" property of the map
+	if (mStreaming)
+	{
+		StartStreaming(aMap);
+	}
+	else
+	{
+		for (std::vector<RXRect>::iterator it = aMap.walls.begin(); it != aMap.walls.end(); ++it)
+		{
+			mPartInst->mApp.GetModule<ObjectManager>().AddWall(*it);
+		}
+
+		for (std::vector<staged_object>::iterator it = aMap.objects.begin(); it != aMap.objects.end(); ++it)
+		{
+			SpawnMapObject(*it);
+		}
+	}
+
+	//walls don't change while the map is active
+	mPartInst->mApp.GetImplementation<ObjectManager, ObjectManager::ObjectManagerImpl>()->BuildWallGrid();
+
+	if (LoadFunction != nullptr)
+	{
+		LoadFunction();
+	}
+}
+
+void SceneController::SceneControllerImpl::StartAsyncLoad(const char* filename)
+{
+	DiscardAsyncLoad();
+
+	mStagedPath = filename;
+	mLoadState = MAP_LOAD_PARSING;
+
+	//a cached map goes straight to its textures
+	mStagedMap = TakeCachedMap(filename);
+	if (mStagedMap != nullptr)
+	{
+		mStagedParsed = true;
+		mLoadProgress = MAP_LOAD_PARSED_PROGRESS;
+		return;
+	}
+
+	mStagedMap = new staged_map();
+	mStagedParsed = false;
+	mLoadProgress = 0;
+
+	std::string lPath = filename;
+	staged_map* lMap = mStagedMap;
+	mLoadThread = std::thread([this, lPath, lMap]()
+	{
+		if (!ParseMap(lPath.c_str(), *lMap, &mLoadProgress) && lMap->error == "")
+		{
+			lMap->error = "couldn't load map " + lPath;
+		}
+		mStagedParsed = true;
+	});
+}
+
+void SceneController::SceneControllerImpl::UpdateAsyncLoad()
+{
+	if (mLoadState == MAP_LOAD_PARSING)
+	{
+		if (!mStagedParsed)
+		{
+			return;
+		}
+		if (mLoadThread.joinable())
+		{
+			mLoadThread.join();
+		}
+
+		for (std::vector<std::string>::iterator it = mStagedMap->warnings.begin(); it != mStagedMap->warnings.end(); ++it)
+		{
+			Logger::Console_log(LogLevel::LOG_WARN, (*it).c_str());
+		}
+		if (mStagedMap->error != "")
+		{
+			Logger::Console_log(LogLevel::LOG_ERROR, mStagedMap->error.c_str());
+			DiscardAsyncLoad();
+			return;
+		}
+
+		//the textures are decoded by the decoding pool, the map keeps the same ids when it is applied
+		Textures& lTextures = mPartInst->mApp.GetModule<Textures>();
+		mStagedTextures.clear();
+		for (std::vector<staged_tileset>::iterator it = mStagedMap->tilesets.begin(); it != mStagedMap->tilesets.end(); ++it)
+		{
+			mStagedTextures.push_back(lTextures.Load_Texture_Async((mStagedMap->folder + (*it).image).c_str()));
+		}
+		for (std::vector<staged_background>::iterator it = mStagedMap->backgrounds.begin(); it != mStagedMap->backgrounds.end(); ++it)
+		{
+			mStagedTextures.push_back(lTextures.Load_Texture_Async((mStagedMap->folder + (*it).image).c_str()));
+		}
+		mLoadState = MAP_LOAD_TEXTURES;
+	}
+
+	if (mLoadState == MAP_LOAD_TEXTURES)
+	{
+		//textures that failed are not waited for, the map shows them as missing like on a normal load
+		Textures& lTextures = mPartInst->mApp.GetModule<Textures>();
+		int lDecoded = 0;
+		for (std::vector<TextureID>::iterator it = mStagedTextures.begin(); it != mStagedTextures.end(); ++it)
+		{
+			if (!lTextures.Is_Texture_Decoding(*it))
+			{
+				++lDecoded;
+			}
+		}
+
+		int lTextureCount = mStagedTextures.size();
+		if (lDecoded < lTextureCount)
+		{
+			mLoadProgress = MAP_LOAD_PARSED_PROGRESS + (MAP_LOAD_TEXTURES_PROGRESS - MAP_LOAD_PARSED_PROGRESS) * lDecoded / lTextureCount;
+			return;
+		}
+
+		//swapped between two frames so the scene never shows half a map
+		ApplyStagedMap(*mStagedMap, mMapCacheSize > 0);
+		CacheMap(mStagedPath.c_str(), mStagedMap);
+		mStagedMap = nullptr;
+		mStagedTextures.clear();
+		mLoadState = MAP_LOAD_IDLE;
+		mLoadProgress = 100;
+	}
+}
+
+void SceneController::SceneControllerImpl::DiscardAsyncLoad()
+{
+	if (mLoadThread.joinable())
+	{
+		mLoadThread.join();
+	}
+	if (mStagedMap != nullptr)
+	{
+		//a map that was parsed is still good for the next time it is loaded
+		if (mStagedParsed && mStagedMap->error == "")
+		{
+			CacheMap(mStagedPath.c_str(), mStagedMap);
+		}
+		else
+		{
+			delete mStagedMap;
+		}
+		mStagedMap = nullptr;
+	}
+	mStagedTextures.clear();
+	if (mLoadState != MAP_LOAD_IDLE)
+	{
+		mLoadState = MAP_LOAD_IDLE;
+		mLoadProgress = 0;
+	}
+}
+
+staged_map* SceneController::SceneControllerImpl::TakeCachedMap(const char* filename)
+{
+	for (std::list<cached_map>::iterator it = mMapCache.begin(); it != mMapCache.end(); ++it)
+	{
+		if ((*it).path != filename)
+		{
+			continue;
+		}
+
+		staged_map* lMap = (*it).map;
+		mMapCacheBytes -= (*it).bytes;
+		mMapCache.erase(it);
+
+		//maps edited after they were parsed are read again
+		if (FileChangedSince(filename, lMap->parse_time, lMap->source_size)
+			|| (lMap->file_path != "" && FileChangedSince(lMap->file_path.c_str(), lMap->parse_time, lMap->compiled_size)))
+		{
+			delete lMap;
+			return nullptr;
+		}
+		return lMap;
+	}
+	return nullptr;
+}
+
+void SceneController::SceneControllerImpl::CacheMap(const char* filename, staged_map* aMap)
+{
+	if (mMapCacheSize <= 0)
+	{
+		delete aMap;
+		return;
+	}
+
+	for (std::list<cached_map>::iterator it = mMapCache.begin(); it != mMapCache.end(); ++it)
+	{
+		if ((*it).path == filename)
+		{
+			mMapCacheBytes -= (*it).bytes;
+			delete (*it).map;
+			mMapCache.erase(it);
+			break;
+		}
+	}
+
+	//they were already reported when the map was parsed
+	aMap->warnings.clear();
+
+	//an open mapping would keep the MapCompiler from writing the file again
+	unsigned long long lBytes = 0;
+	for (std::vector<staged_layer>::iterator it = aMap->layers.begin(); it != aMap->layers.end(); ++it)
+	{
+		int lSize = (*it).width * (*it).height;
+		if (!(*it).owns_data)
+		{
+			uint* lData = new uint[lSize];
+			memcpy(lData, (*it).data, lSize * sizeof(uint));
+			(*it).data = lData;
+			(*it).owns_data = true;
+		}
+		lBytes += (unsigned long long)lSize * sizeof(uint);
+	}
+	aMap->file.Close();
+
+	cached_map lCached = { filename, aMap, lBytes };
+	mMapCache.push_front(lCached);
+	mMapCacheBytes += lBytes;
+	while (!mMapCache.empty() && ((int)mMapCache.size() > mMapCacheSize || mMapCacheBytes > mMapCacheMaxBytes))
+	{
+		mMapCacheBytes -= mMapCache.back().bytes;
+		delete mMapCache.back().map;
+		mMapCache.pop_back();
+	}
+}
+
+void SceneController::SceneControllerImpl::ClearMapCache()
+{
+	for (std::list<cached_map>::iterator it = mMapCache.begin(); it != mMapCache.end(); ++it)
+	{
+		delete (*it).map;
+	}
+	mMapCache.clear();
+	mMapCacheBytes = 0;
+}
+
+void SceneController::SceneControllerImpl::CollectPreloadedMaps()
+{
+	preloaded_map lPreloaded;
+	while (mPreloader.PopFinished(lPreloaded))
+	{
+		staged_map* lMap = lPreloaded.map;
+		for (std::vector<std::string>::iterator it = lMap->warnings.begin(); it != lMap->warnings.end(); ++it)
+		{
+			Logger::Console_log(LogLevel::LOG_WARN, (*it).c_str());
+		}
+		if (lMap->error != "")
+		{
+			Logger::Console_log(LogLevel::LOG_WARN, lMap->error.c_str());
+			delete lMap;
+			continue;
+		}
+
+		//the textures are decoded too so entering the map doesn't wait for them
+		Textures& lTextures = mPartInst->mApp.GetModule<Textures>();
+		for (std::vector<staged_tileset>::iterator it = lMap->tilesets.begin(); it != lMap->tilesets.end(); ++it)
+		{
+			lTextures.Load_Texture_Async((lMap->folder + (*it).image).c_str());
+		}
+		for (std::vector<staged_background>::iterator it = lMap->backgrounds.begin(); it != lMap->backgrounds.end(); ++it)
+		{
+			lTextures.Load_Texture_Async((lMap->folder + (*it).image).c_str());
+		}
+
+		CacheMap(lPreloaded.path.c_str(), lMap);
+	}
+}
+
+void SceneController::SceneControllerImpl::StartStreaming(staged_map& aMap)
+{
+	if (tilesets.empty())
+	{
+		Logger::Console_log(LogLevel::LOG_WARN, "Streamed map without tilesets, loading all of it");
+		mStreaming = false;
+		for (std::vector<RXRect>::iterator it = aMap.walls.begin(); it != aMap.walls.end(); ++it)
+		{
+			mPartInst->mApp.GetModule<ObjectManager>().AddWall(*it);
+		}
+		for (std::vector<staged_object>::iterator it = aMap.objects.begin(); it != aMap.objects.end(); ++it)
+		{
+			SpawnMapObject(*it);
+		}
+		return;
+	}
+
+	//regions follow the tiles of the first tileset, the one the room size is measured in
+	mRegionTiles = mStreamRegionSize;
+	mRegionW = mRegionTiles * tilesets[0]->tile_width;
+	mRegionH = mRegionTiles * tilesets[0]->tile_height;
+	mRegionsX = max(1, (room_w + mRegionTiles - 1) / mRegionTiles);
+	mRegionsY = max(1, (room_h + mRegionTiles - 1) / mRegionTiles);
+	mRegions.assign(mRegionsX * mRegionsY, stream_region());
+
+	//a wall belongs to every region it overlaps and stays while any of them is loaded
+	mStreamedWalls.resize(aMap.walls.size());
+	for (uint i = 0; i < aMap.walls.size(); ++i)
+	{
+		const RXRect& lRect = aMap.walls[i];
+		mStreamedWalls[i].rect = lRect;
+
+		int lFirst = GetRegionAt(lRect.x, lRect.y);
+		int lLast = GetRegionAt(lRect.x + max(lRect.w - 1, 0), lRect.y + max(lRect.h - 1, 0));
+		for (int y = lFirst / mRegionsX; y <= lLast / mRegionsX; ++y)
+		{
+			for (int x = lFirst % mRegionsX; x <= lLast % mRegionsX; ++x)
+			{
+				mRegions[y * mRegionsX + x].walls.push_back(i);
+			}
+		}
+	}
+
+	//objects with "streamed" set to false are spawned now and never despawned, like the player
+	std::vector<RXRect> lPersistentAreas;
+	for (std::vector<staged_object>::iterator it = aMap.objects.begin(); it != aMap.objects.end(); ++it)
+	{
+		bool lStreamed = true;
+		for (std::vector<ObjectProperty>::iterator prop = (*it).properties.begin(); prop != (*it).properties.end(); ++prop)
+		{
+			if ((*prop).name == "streamed")
+			{
+				lStreamed = (*prop).bool_value;
+			}
+		}
+
+		if (!lStreamed)
+		{
+			GameObject* lSpawned = SpawnMapObject(*it);
+			if (lSpawned != nullptr)
+			{
+				lPersistentAreas.push_back(lSpawned->collider);
+			}
+			continue;
+		}
+
+		mRegions[GetRegionAt((*it).x, (*it).y)].objects.push_back(mStreamedObjects.size());
+		mStreamedObjects.push_back(streamed_object());
+		mStreamedObjects.back().record = *it;
+	}
+
+	//only the tiles of compiled maps are read from the disk as they are needed
+	for (std::vector<layer*>::iterator it = layers.begin(); it != layers.end(); ++it)
+	{
+		if (!(*it)->owns_data)
+		{
+			mPrefetcher.Start();
+			break;
+		}
+	}
+
+	//the camera only moves after this frame's update, the regions it may end up on are loaded now
+	//regions are in world units, like the area the camera sees
+	RXRect lView = mPartInst->mApp.GetModule<Camera>().GetWorldArea();
+	LoadRegionsAround(lView);
+
+	//a camera following one of these objects is centered on it
+	for (std::vector<RXRect>::iterator it = lPersistentAreas.begin(); it != lPersistentAreas.end(); ++it)
+	{
+		RXRect lArea = { (*it).x + (*it).w / 2 - lView.w / 2, (*it).y + (*it).h / 2 - lView.h / 2, lView.w, lView.h };
+		LoadRegionsAround(lArea);
+	}
+
+	mStreamFirstUpdate = true;
+
+	std::stringstream lStr;
+	lStr << "Streaming map in " << mRegionsX << "x" << mRegionsY << " regions";
+	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+}
+
+void SceneController::SceneControllerImpl::StopStreaming()
+{
+	//the prefetcher reads the mapped file, it has to stop before the file is closed
+	mPrefetcher.Stop();
+
+	mStreaming = false;
+	mRegions.clear();
+	mStreamedWalls.clear();
+	mStreamedObjects.clear();
+	mLiveStreamedObjects.clear();
+}
+
+int SceneController::SceneControllerImpl::GetRegionAt(int x, int y)
+{
+	int lX = (int)floorf((float)x / mRegionW);
+	int lY = (int)floorf((float)y / mRegionH);
+	lX = min(max(lX, 0), mRegionsX - 1);
+	lY = min(max(lY, 0), mRegionsY - 1);
+	return lY * mRegionsX + lX;
+}
+
+void SceneController::SceneControllerImpl::UpdateStreaming()
+{
+	//regions touching the screen plus the radius around them, in world units
+	RXRect lScreen = mPartInst->mApp.GetModule<Camera>().GetWorldArea();
+	int lFirstX = (int)floorf((float)lScreen.x / mRegionW) - mStreamRadius;
+	int lFirstY = (int)floorf((float)lScreen.y / mRegionH) - mStreamRadius;
+	int lLastX = (int)floorf((float)(lScreen.x + lScreen.w) / mRegionW) + mStreamRadius;
+	int lLastY = (int)floorf((float)(lScreen.y + lScreen.h) / mRegionH) + mStreamRadius;
+
+	int lRegion;
+	while (mPrefetcher.PopFinished(lRegion))
+	{
+		//regions that went out of range while they were being read are left unloaded
+		if (mRegions[lRegion].state == REGION_PREFETCHING)
+		{
+			mRegions[lRegion].state = REGION_READY;
+		}
+	}
+
+	//regions are kept one more region away than they are loaded so a camera on the border doesn't reload them every frame
+	bool lUnloaded = false;
+	for (int i = 0; i < (int)mRegions.size() && !mStreamFirstUpdate; ++i)
+	{
+		int lX = i % mRegionsX;
+		int lY = i / mRegionsX;
+		if (mRegions[i].state != REGION_UNLOADED && (lX < lFirstX - 1 || lX > lLastX + 1 || lY < lFirstY - 1 || lY > lLastY + 1))
+		{
+			if (mRegions[i].state == REGION_LOADED)
+			{
+				UnloadRegion(i);
+				lUnloaded = true;
+			}
+			mRegions[i].state = REGION_UNLOADED;
+		}
+	}
+	if (lUnloaded)
+	{
+		DespawnStreamedObjects();
+	}
+
+	//what StartStreaming didn't load is spread over the frames
+	int lBudget = mStreamRegionsPerFrame;
+	for (int y = max(lFirstY, 0); y <= min(lLastY, mRegionsY - 1); ++y)
+	{
+		for (int x = max(lFirstX, 0); x <= min(lLastX, mRegionsX - 1); ++x)
+		{
+			int i = y * mRegionsX + x;
+			stream_region& lStreamRegion = mRegions[i];
+			if (lStreamRegion.state == REGION_UNLOADED)
+			{
+				if (mPrefetcher.IsRunning())
+				{
+					prefetch_job lJob;
+					lJob.region = i;
+					for (std::vector<layer*>::iterator it = layers.begin(); it != layers.end(); ++it)
+					{
+						layer* lLayer = *it;
+						if (lLayer->owns_data)
+						{
+							continue;
+						}
+
+						//one range per row of the region, the rows of the layer are contiguous in the file
+						int lTileX = x * mRegionW / lLayer->tileset_of_layer->tile_width;
+						int lTileY = y * mRegionH / lLayer->tileset_of_layer->tile_height;
+						int lTilesX = min(mRegionW / lLayer->tileset_of_layer->tile_width, lLayer->width - lTileX);
+						int lTilesY = min(mRegionH / lLayer->tileset_of_layer->tile_height, lLayer->height - lTileY);
+						for (int row = 0; row < lTilesY && lTilesX > 0; ++row)
+						{
+							prefetch_range lRange = { (const char*)(lLayer->data + (lTileY + row) * lLayer->width + lTileX), lTilesX * sizeof(uint) };
+							lJob.ranges.push_back(lRange);
+						}
+					}
+					mPrefetcher.Push(lJob);
+					lStreamRegion.state = REGION_PREFETCHING;
+				}
+				else
+				{
+					lStreamRegion.state = REGION_READY;
+				}
+			}
+
+			if (lStreamRegion.state == REGION_READY && lBudget > 0)
+			{
+				LoadRegion(i);
+				--lBudget;
+			}
+		}
+	}
+
+	mStreamFirstUpdate = false;
 }
 
-bool SceneController::SceneControllerImpl::LoadTilesets(pugi::xml_node & node, const char* aMapFolder)
+void SceneController::SceneControllerImpl::LoadRegionsAround(const RXRect& aArea)
 {
-	tileset* set = new tileset(
-	node.attribute("firstgid").as_int(),
-	node.attribute("tilewidth").as_int(),
-	node.attribute("tileheight").as_int(),
-	node.attribute("columns").as_int(),
-	node.attribute("tilecount").as_int());
-
-
-	pugi::xml_node imagenode = node.child("image");
-	std::string base_folder = aMapFolder;
-	base_folder += imagenode.attribute("source").as_string();
-
-	//load this texture
-	set->texture = mPartInst->mApp.GetModule<Textures>().Load_Texture(base_folder.c_str());
-	tilesets.push_back(set);
+	int lFirstX = max((int)floorf((float)aArea.x / mRegionW) - mStreamRadius, 0);
+	int lFirstY = max((int)floorf((float)aArea.y / mRegionH) - mStreamRadius, 0);
+	int lLastX = min((int)floorf((float)(aArea.x + aArea.w) / mRegionW) + mStreamRadius, mRegionsX - 1);
+	int lLastY = min((int)floorf((float)(aArea.y + aArea.h) / mRegionH) + mStreamRadius, mRegionsY - 1);
 
-	return true;
+	for (int y = lFirstY; y <= lLastY; ++y)
+	{
+		for (int x = lFirstX; x <= lLastX; ++x)
+		{
+			if (mRegions[y * mRegionsX + x].state != REGION_LOADED)
+			{
+				LoadRegion(y * mRegionsX + x);
+			}
+		}
+	}
 }
 
-bool SceneController::SceneControllerImpl::LoadBackgroundImage(pugi::xml_node& node, const char* aMapFolder)
+void SceneController::SceneControllerImpl::LoadRegion(int aRegion)
 {
-	int depth;
-	float parallax_x, parallax_y;
-	bool repeat_y;
+	stream_region& lRegion = mRegions[aRegion];
+	ObjectManager& lObjects = mPartInst->mApp.GetModule<ObjectManager>();
 
-	pugi::xml_node iterator;
-	pugi::xml_node properties_node = node.child("properties");
-	for (iterator = properties_node.first_child(); iterator; iterator = iterator.next_sibling())
+	for (std::vector<uint>::iterator it = lRegion.walls.begin(); it != lRegion.walls.end(); ++it)
 	{
-		std::string temp = iterator.attribute("name").as_string();
-		if (temp == "depth")
-		{
-			depth = iterator.attribute("value").as_int(20);
-		}
-		else if (temp == "parallax_x")
+		streamed_wall& lWall = mStreamedWalls[*it];
+		if (lWall.users++ == 0)
 		{
-			parallax_x = iterator.attribute("value").as_float(1);
+			lWall.id = lObjects.AddWall(lWall.rect);
 		}
-		else if (temp == "parallax_y")
+	}
+
+	for (std::vector<uint>::iterator it = lRegion.objects.begin(); it != lRegion.objects.end(); ++it)
+	{
+		//objects that walked into another loaded region are still alive
+		streamed_object& lObject = mStreamedObjects[*it];
+		if (lObject.handle != 0 && lObjects.IsObjectAlive(lObject.handle))
 		{
-			parallax_y = iterator.attribute("value").as_float(1);
+			continue;
 		}
-		else if (temp == "repeat_y")
+
+		GameObject* lSpawned = SpawnMapObject(lObject.record);
+		lObject.handle = lSpawned != nullptr ? lSpawned->GetHandle() : 0;
+		if (lObject.handle != 0)
 		{
-			repeat_y = iterator.attribute("value").as_bool(true);
+			mLiveStreamedObjects.push_back(*it);
 		}
 	}
 
-	pugi::xml_node imagenode = node.child("image");
-	const char* path = imagenode.attribute("source").as_string();
-
-	std::string base_folder = aMapFolder;
-	base_folder += path;
-
-	//load this texture
-	TextureID texture = mPartInst->mApp.GetModule<Textures>().Load_Texture(base_folder.c_str());
-
-	background_texture* back = new background_texture(texture, parallax_x, parallax_y, depth, path, repeat_y);
-	active_backgrounds.push_back(back);
-
-	return true;
+	lRegion.state = REGION_LOADED;
 }
 
-bool SceneController::SceneControllerImpl::LoadMapExecute(const char* filename)
+void SceneController::SceneControllerImpl::UnloadRegion(int aRegion)
 {
-	mPartInst->CleanMap();
-	mPartInst->mApp.GetModule<ObjectManager>().Clearphysics();
-	mPartInst->mApp.GetImplementation<Particles,Particles::ParticlesImpl>()->ClearParticles();
-
-	std::stringstream lStr;
-	lStr << "Loading map from: " << filename;
-	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+	stream_region& lRegion = mRegions[aRegion];
+	ObjectManager& lObjects = mPartInst->mApp.GetModule<ObjectManager>();
 
-	pugi::xml_document	map_file;
-	pugi::xml_node map_node;
-	pugi::xml_parse_result result = map_file.load_file(filename);
-
-	if (result == NULL)
+	for (std::vector<uint>::iterator it = lRegion.walls.begin(); it != lRegion.walls.end(); ++it)
 	{
-		std::string errstr = "couldn't find map ";
-		errstr += filename;
-		Logger::Console_log(LogLevel::LOG_ERROR, errstr.c_str());
-		return false;
+		streamed_wall& lWall = mStreamedWalls[*it];
+		if (--lWall.users == 0)
+		{
+			lObjects.DeleteWall(lWall.id);
+			lWall.id = -1;
+		}
 	}
 
-	//start!
-	map_node = map_file.child("map");
-	pugi::xml_node iterator;
-
-	std::string lMapFolder = GetDirectoryFromPath(filename);
-
-	pugi::xml_node layer_node = map_node.first_child();
-	for (iterator = layer_node; iterator; iterator = iterator.next_sibling())
+	int lX = aRegion % mRegionsX;
+	int lY = aRegion / mRegionsX;
+	for (std::vector<layer*>::iterator it = layers.begin(); it != layers.end(); ++it)
 	{
-		std::string iterator_name = iterator.name();
-		if (iterator_name == "tileset")
-		{
-			LoadTilesets(iterator, lMapFolder.c_str());
-		}
-		if(iterator_name == "imagelayer")
+		layer* lLayer = *it;
+		int lTileX = lX * mRegionW / lLayer->tileset_of_layer->tile_width;
+		int lTileY = lY * mRegionH / lLayer->tileset_of_layer->tile_height;
+		int lLastX = min((lX + 1) * mRegionW / lLayer->tileset_of_layer->tile_width, lLayer->width) - 1;
+		int lLastY = min((lY + 1) * mRegionH / lLayer->tileset_of_layer->tile_height, lLayer->height) - 1;
+		if (lTileX > lLastX || lTileY > lLastY)
 		{
-			LoadBackgroundImage(iterator, lMapFolder.c_str());
+			continue;
 		}
-		if (iterator_name == "objectgroup")
-		{
-			bool isWallLayer = false;
-			pugi::xml_node lProperties = iterator.child("properties");
 
-			pugi::xml_node iterator_prop;
-			for (iterator_prop = lProperties.first_child(); iterator_prop; iterator_prop = iterator_prop.next_sibling())
-			{
-				pugi::xml_attribute lName = iterator_prop.attribute("name");
-				if (std::strcmp(lName.value(), "isWallLayer") == 0)
-				{
-					isWallLayer = iterator_prop.attribute("value").as_bool(false);
-				}
-			}
-			if(isWallLayer)
+		lLayer->ClearChunks(lTileX, lTileY, lLastX, lLastY);
+
+		//tiles of compiled maps go back to the file until the region is close again
+		if (!lLayer->owns_data)
+		{
+			for (int row = lTileY; row <= lLastY; ++row)
 			{
-				LoadWalls(iterator);
+				MappedFile::Release((const char*)(lLayer->data + row * lLayer->width + lTileX), (lLastX - lTileX + 1) * sizeof(uint));
 			}
-			else
+		}
+	}
+}
+
+void SceneController::SceneControllerImpl::DespawnStreamedObjects()
+{
+	ObjectManager& lObjects = mPartInst->mApp.GetModule<ObjectManager>();
+
+	for (uint i = 0; i < mLiveStreamedObjects.size();)
+	{
+		streamed_object& lRecord = mStreamedObjects[mLiveStreamedObjects[i]];
+		GameObject* lObject = lObjects.GetObjectFromHandle(lRecord.handle);
+
+		//objects are kept while their center is inside of a loaded region
+		bool lKeep = false;
+		if (lObject != nullptr)
+		{
+			int lRegion = GetRegionAt(lObject->collider.x + lObject->collider.w / 2, lObject->collider.y + lObject->collider.h / 2);
+			lKeep = lObject->always_active || mRegions[lRegion].state == REGION_LOADED;
+			if (!lKeep)
 			{
-				LoadObjects(iterator);
+				lObjects.DeleteObject(lObject);
 			}
 		}
-		if (iterator_name == "layer")
+
+		if (lKeep)
 		{
-			LoadTiles(iterator);
+			++i;
 		}
-		if (iterator_name == "properties")
+		else
 		{
-			LoadMapProperties(iterator);
+			lRecord.handle = 0;
+			mLiveStreamedObjects[i] = mLiveStreamedObjects.back();
+			mLiveStreamedObjects.pop_back();
 		}
 	}
-
-	if (LoadFunction != nullptr)
-	{
-		LoadFunction();
-	}
-
-	return true;
 }
 
-void SceneController::SceneControllerImpl::LoadMapProperties(pugi::xml_node & node)
+void SceneController::SceneControllerImpl::LoadMapProperties(pugi::xml_node & node, staged_map& aMap)
 {
 	pugi::xml_node iterator;
 	pugi::xml_node property_node = node.first_child();
 	for (iterator = property_node; iterator; iterator = iterator.next_sibling())
 	{
-		std::string name = iterator.attribute("name").as_string();
-		if (name == "music")
+		aMap.properties.push_back(std::make_pair(std::string(iterator.attribute("name").as_string()), iterator.attribute("value").as_int(0)));
+	}
+}
+
+void SceneController::SceneControllerImpl::ApplyMapProperty(const std::string& aName, int aValue)
+{
+	if (aName == "music")
+	{
+		//App->aud->PlayMusic(aValue,500);
+	}
+	if (aName == "streaming")
+	{
+		mStreaming = aValue != 0;
+	}
+	//"prewarm:Type" makes room in the pool of that object type so spawning it doesn't allocate
+	if (aName.compare(0, 8, "prewarm:") == 0)
+	{
+		FactoryBase* lFactory = mPartInst->mApp.GetImplementation<ObjectManager,ObjectManager::ObjectManagerImpl>()->GetFactory(aName.substr(8).c_str());
+		if (lFactory != nullptr)
 		{
-			//App->aud->PlayMusic(iterator.attribute("value").as_int(1),500);
+			lFactory->Prewarm(aValue);
 		}
 	}
 }
@@ -244,7 +1338,7 @@ bool SceneController::SceneControllerImpl::LoadBackground(pugi::xml_node& imagel
 	return true;
 }
 
-bool SceneController::SceneControllerImpl::LoadWalls(pugi::xml_node& objectgroup_node)
+bool SceneController::SceneControllerImpl::LoadWalls(pugi::xml_node& objectgroup_node, staged_map& aMap)
 {
 	pugi::xml_node object_iterator;
 	for (object_iterator = objectgroup_node.child("object"); object_iterator; object_iterator = object_iterator.next_sibling())
@@ -254,92 +1348,109 @@ bool SceneController::SceneControllerImpl::LoadWalls(pugi::xml_node& objectgroup
 		newwall.y = object_iterator.attribute("y").as_int();
 		newwall.w = object_iterator.attribute("width").as_int();
 		newwall.h = object_iterator.attribute("height").as_int();
-		mPartInst->mApp.GetModule<ObjectManager>().AddWall(newwall);
+		aMap.walls.push_back(newwall);
 	}
 
 	return true;
 }
 
-bool SceneController::SceneControllerImpl::LoadObjects(pugi::xml_node& objectgroup_node)
+bool SceneController::SceneControllerImpl::LoadObjects(pugi::xml_node& objectgroup_node, staged_map& aMap)
 {
 	pugi::xml_node object_iterator;
 	for (object_iterator = objectgroup_node.child("object"); object_iterator; object_iterator = object_iterator.next_sibling())
 	{
-		int x = object_iterator.attribute("x").as_int();
-		int y = object_iterator.attribute("y").as_int();// -object_iterator.attribute("height").as_int();//tile height inside tiled
-		int w = 0;
-		int h = 0;
-		std::string type = object_iterator.attribute("type").as_string();
-
-		GameObject*ret = nullptr;
-
-		w = object_iterator.attribute("width").as_int();
-		h = object_iterator.attribute("height").as_int();
+		staged_object lObject;
+		lObject.x = object_iterator.attribute("x").as_int();
+		lObject.y = object_iterator.attribute("y").as_int();// -object_iterator.attribute("height").as_int();//tile height inside tiled
+		lObject.type = object_iterator.attribute("type").as_string();
 
-		//std::map<std::string, float> lProperties;
-
-		std::list<ObjectProperty*> lProperties;
+		lObject.w = object_iterator.attribute("width").as_int();
+		lObject.h = object_iterator.attribute("height").as_int();
 
 		pugi::xml_node properties_node = object_iterator.child("properties");
 		pugi::xml_node iterator;
 
 		for (iterator = properties_node.first_child(); iterator; iterator = iterator.next_sibling())
 		{
-			ObjectProperty* lObjProp = new ObjectProperty();
+			ObjectProperty lObjProp = ObjectProperty();
 
-			lObjProp->name = iterator.attribute("name").as_string();
+			lObjProp.name = iterator.attribute("name").as_string();
 			std::string type = iterator.attribute("type").as_string();
-			float value = 0;
 			if (strcmp(type.c_str(), "bool") == 0)
 			{
-				lObjProp->bool_value = iterator.attribute("value").as_bool();
+				lObjProp.bool_value = iterator.attribute("value").as_bool();
 			}
 			else if (strcmp(type.c_str(), "float") == 0)
 			{
-				lObjProp->num_value = iterator.attribute("value").as_float();
+				lObjProp.num_value = iterator.attribute("value").as_float();
 			}
 			else if (strcmp(type.c_str(), "int") == 0)
 			{
-				lObjProp->num_value = iterator.attribute("value").as_int();
+				lObjProp.num_value = iterator.attribute("value").as_int();
 			}
 			else if (strcmp(iterator.attribute("value").as_string(""), "") != 0)
 			{
-				lObjProp->str_value = iterator.attribute("value").as_string("");
+				lObjProp.str_value = iterator.attribute("value").as_string("");
 			}
 
-			lProperties.push_back(lObjProp);
+			lObject.properties.push_back(lObjProp);
 		}
 
-		auto lID = mPartInst->mApp.GetImplementation<ObjectManager,ObjectManager::ObjectManagerImpl>()->GetFactory(type.c_str());
-		
-		if (lID != nullptr)
-		{
-			ret = (*lID).CreateInstace(lProperties);
-			ret->mType = lID->GetObjectTypeIndex();
-			ret->Engine = new EngineAPI(mPartInst->mApp);
-			ret->collider.x = x;
-			ret->collider.y = y;
-			ret->collider.w = w;
-			ret->collider.h = h;
+		aMap.objects.push_back(lObject);
+	}
 
-			ret->Init();
+	return true;
+}
 
-			mPartInst->mApp.GetModule<ObjectManager>().AddObject(ret);
-		}
+GameObject* SceneController::SceneControllerImpl::SpawnMapObject(const staged_object& aObject)
+{
+	//the object owns its properties
+	std::list<ObjectProperty*> lProperties;
+	for (std::vector<ObjectProperty>::const_iterator it = aObject.properties.begin(); it != aObject.properties.end(); ++it)
+	{
+		lProperties.push_back(new ObjectProperty(*it));
 	}
+	return SpawnMapObject(aObject.x, aObject.y, aObject.w, aObject.h, aObject.type.c_str(), lProperties);
+}
 
-	return true;
+GameObject* SceneController::SceneControllerImpl::SpawnMapObject(int x, int y, int w, int h, const char* aType, std::list<ObjectProperty*>& aProperties)
+{
+	auto lID = mPartInst->mApp.GetImplementation<ObjectManager,ObjectManager::ObjectManagerImpl>()->GetFactory(aType);
+
+	if (lID != nullptr)
+	{
+		GameObject* ret = (*lID).CreateInstace(aProperties);
+		ret->mType = lID->GetObjectTypeIndex();
+		ret->Engine = mPartInst->mApp.GetImplementation<ObjectManager,ObjectManager::ObjectManagerImpl>()->NewEngine();
+		ret->collider.x = x;
+		ret->collider.y = y;
+		ret->collider.w = w;
+		ret->collider.h = h;
+
+		//the object has its handle during Init
+		mPartInst->mApp.GetModule<ObjectManager>().AddObject(ret);
+
+		ret->Init();
+		return ret;
+	}
+	return nullptr;
 }
 
-bool SceneController::SceneControllerImpl::LoadTiles(pugi::xml_node & tile_node)
+bool SceneController::SceneControllerImpl::LoadTiles(pugi::xml_node & tile_node, staged_map& aMap)
 {
 	//load the main map properties
 	int width = tile_node.attribute("width").as_int();
 	int height = tile_node.attribute("height").as_int();
 	int size = width * height;
 
-	room_w = width;
-	room_h = height;
+	aMap.room_w = width;
+	aMap.room_h = height;
+
+	if (aMap.tilesets.empty())
+	{
+		aMap.error = "tile layer without a tileset";
+		return false;
+	}
 
 	//read from properties
 
@@ -349,7 +1460,7 @@ bool SceneController::SceneControllerImpl::LoadTiles(pugi::xml_node & tile_node)
 	int depth = 20;
 	int parallax_x = 1;
 	int parallax_y = 1;
-	tileset* tileset_of_layer = (*tilesets.begin());
+	uint tileset_of_layer = 0;
 
 	for (iterator = properties_node.first_child(); iterator; iterator = iterator.next_sibling())
 	{
@@ -368,27 +1479,51 @@ bool SceneController::SceneControllerImpl::LoadTiles(pugi::xml_node & tile_node)
 		}
 		else if (temp == "tileset")
 		{
-			int tileset = iterator.attribute("value").as_int(0);
-			tileset_of_layer = tilesets[tileset];
+			tileset_of_layer = iterator.attribute("value").as_uint(0);
+			if (tileset_of_layer >= aMap.tilesets.size())
+			{
+				aMap.error = "tile layer uses a tileset the map doesn't have";
+				return false;
+			}
 		}
 	}
+	int firstgid = aMap.tilesets[tileset_of_layer].firstgid;
 
 	uint* data = new uint[size];
-	pugi::xml_node data_node = tile_node.child("data").first_child();
+	pugi::xml_node encoded_node = tile_node.child("data");
+	const char* encoding = encoded_node.attribute("encoding").as_string();
 
-	for (uint i = 0; i<size; i++)
+	if (encoding[0] != '\0')
 	{
-		data[i] = data_node.attribute("gid").as_uint(-1);
-		if (data[i] != -1)
+		//csv and base64 layers are decoded straight into the tiles
+		std::string lError;
+		if (!DecodeTileData(encoded_node.child_value(), encoding, encoded_node.attribute("compression").as_string(), data, size, lError))
 		{
-			data[i] -= tileset_of_layer->firstgid;
+			aMap.error = "couldn't decode tile layer: ";
+			aMap.error += lError;
+			delete[] data;
+			return false;
 		}
+		GidsToTileIds(data, size, firstgid);
+	}
+	else
+	{
+		pugi::xml_node data_node = encoded_node.first_child();
+
+		for (uint i = 0; i<size; i++)
+		{
+			data[i] = data_node.attribute("gid").as_uint(-1);
+			if (data[i] != -1)
+			{
+				data[i] -= firstgid;
+			}
 
-		data_node = data_node.next_sibling();
+			data_node = data_node.next_sibling();
+		}
 	}
 
-	layer* new_layer = new layer(tileset_of_layer, data, width, height, parallax_x, parallax_y, depth, size);
-	layers.push_back(new_layer);
+	staged_layer new_layer = { data, true, width, height, (float)parallax_x, (float)parallax_y, depth, tileset_of_layer };
+	aMap.layers.push_back(new_layer);
 
 	return true;
 }
@@ -413,6 +1548,97 @@ void SceneController::LoadMap(const char* filename)
 	lImpl->lMapToLoad = filename;
 }
 
+void SceneController::LoadMapAsync(const char* filename)
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	std::stringstream lStr;
+	lStr << "Loading map in the background from: " << filename;
+	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+
+	lImpl->StartAsyncLoad(filename);
+}
+
+bool SceneController::IsLoadingMap()
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return false;
+	}
+
+	return lImpl->mLoadState != MAP_LOAD_IDLE;
+}
+
+int SceneController::GetLoadProgress()
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	return lImpl->mLoadProgress;
+}
+
+void SceneController::SetStreamingRadius(int aRadius)
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	lImpl->mStreamRadius = max(aRadius, 0);
+}
+
+void SceneController::PreloadMap(const char* filename)
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	if (lImpl->mMapCacheSize <= 0)
+	{
+		Logger::Console_log(LogLevel::LOG_WARN, "The map cache is disabled, maps can't be preloaded");
+		return;
+	}
+
+	for (std::list<cached_map>::iterator it = lImpl->mMapCache.begin(); it != lImpl->mMapCache.end(); ++it)
+	{
+		if ((*it).path == filename)
+		{
+			return;
+		}
+	}
+
+	lImpl->mPreloader.Start([lImpl](const char* aPath, staged_map& aMap) { return lImpl->ParseMap(aPath, aMap, nullptr); });
+	lImpl->mPreloader.Push(filename);
+}
+
+void SceneController::ClearMapCache()
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	lImpl->ClearMapCache();
+}
+
 bool SceneController::AssignGameLoopFunction(std::function<void()> aSceneFunction)
 {
 	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
@@ -456,12 +1682,16 @@ void SceneController::CleanMap()
 		return;
 	}
 
+	lImpl->StopStreaming();
+
 	for (std::vector<layer*>::iterator it = lImpl->layers.begin(); it != lImpl->layers.end(); it++)
 	{
 		//delete (*it)->data;
 		delete *it;
 	}
 	lImpl->layers.clear();
+	//no layer points inside of the compiled map anymore
+	lImpl->mMapFile.Close();
 
 
 	for (std::vector<background_texture*>::iterator it = lImpl->active_backgrounds.begin(); it != lImpl->active_backgrounds.end(); it++)
@@ -493,4 +1723,50 @@ void SceneController::GetRoomSize(int& x, int& y)
 	y = lImpl->room_h;
 }
 
+void SceneController::SetTile(int aLayer, int x, int y, int aTileId)
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
+	}
+
+	if (aLayer < 0 || aLayer >= lImpl->layers.size())
+	{
+		return;
+	}
+
+	layer* lLayer = lImpl->layers[aLayer];
+	if (x < 0 || y < 0 || x >= lLayer->width || y >= lLayer->height)
+	{
+		return;
+	}
+
+	lLayer->SetTile(x, y, (uint)aTileId);
+}
+
+int SceneController::GetTile(int aLayer, int x, int y)
+{
+	SceneControllerImpl* lImpl = dynamic_cast<SceneControllerImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return -1;
+	}
+
+	if (aLayer < 0 || aLayer >= lImpl->layers.size())
+	{
+		return -1;
+	}
+
+	layer* lLayer = lImpl->layers[aLayer];
+	if (x < 0 || y < 0 || x >= lLayer->width || y >= lLayer->height)
+	{
+		return -1;
+	}
+
+	return (int)lLayer->data[y * lLayer->width + x];
+}
+
 #pragma endregion
\ No newline at end of file
@@ -2,7 +2,33 @@
 #define SCENE_CONTROLLER_IMPL__H
 
 #include "../include/Modules/SceneController.h"
+#include "../include/Modules/ObjectManager.h"
 #include "PartImpl.h"
+#include "MappedFile.h"
+#include "RegionPrefetcher.h"
+#include "MapPreloader.h"
+#include <atomic>
+
+//size in tiles of the side of a cached layer chunk
+#define TILE_CHUNK_SIZE 32
+
+//progress of a background load once the map is parsed and once its textures are decoded, the swap makes it 100
+#define MAP_LOAD_PARSED_PROGRESS 70
+#define MAP_LOAD_TEXTURES_PROGRESS 95
+
+//parsed maps kept to load them again without reading their files, off unless the config asks for it
+#define MAP_CACHE_DEFAULT_SIZE 0
+//megabytes of tiles the cached maps can take
+#define MAP_CACHE_DEFAULT_MAX_MB 64
+
+//side in tiles of the streamed regions, rounded up to a multiple of TILE_CHUNK_SIZE
+#define STREAMING_DEFAULT_REGION_SIZE 64
+//regions kept loaded around the ones on screen
+#define STREAMING_DEFAULT_RADIUS 1
+//regions that add their walls and objects in the same frame
+#define STREAMING_DEFAULT_REGIONS_PER_FRAME 1
+
+struct SDL_Texture;
 
 struct tileset
 {
@@ -21,6 +47,16 @@ struct tileset
 };
 
 
+//a block of TILE_CHUNK_SIZE x TILE_CHUNK_SIZE tiles pre-rendered into a target texture
+struct tile_chunk
+{
+	SDL_Texture* texture = nullptr;
+	//set when a tile inside of the chunk changed and the texture has to be rendered again
+	bool dirty = true;
+	//render target generation the texture was baked in, targets can be lost on device resets
+	uint baked_generation = 0;
+};
+
 struct layer
 {
 	uint* data;
@@ -33,12 +69,46 @@ struct layer
 
 	tileset* tileset_of_layer;
 
+	//cached chunks of the layer, row major
+	std::vector<tile_chunk> chunks;
+	//indices of the chunks that were given a texture, the far ones are found without visiting every chunk
+	std::vector<int> baked_chunks;
+	int chunks_x;
+	int chunks_y;
+	//turned off if the renderer can't create target textures, tiles are then drawn one by one
+	bool use_chunks = true;
+	//false when data points inside of a mapped map file
+	bool owns_data = true;
+
 	layer(tileset* aTileset,uint* aData, int aWidth, int aHeight, float aParallax_x, float aParallax_y, int aDepth, int aSize)
-		: tileset_of_layer(aTileset), data(aData), width(aWidth), height(aHeight), parallax_x(aParallax_x), parallax_y(aParallax_y), depth(aDepth), size(aSize) {}
+		: tileset_of_layer(aTileset), data(aData), width(aWidth), height(aHeight), parallax_x(aParallax_x), parallax_y(aParallax_y), depth(aDepth), size(aSize) 
+	{
+		chunks_x = (width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+		chunks_y = (height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+		chunks.resize(chunks_x * chunks_y);
+	}
+
+	//changes a tile and marks its chunk to be rendered again
+	void SetTile(int x, int y, uint aId)
+	{
+		data[y * width + x] = aId;
+		chunks[(y / TILE_CHUNK_SIZE) * chunks_x + (x / TILE_CHUNK_SIZE)].dirty = true;
+	}
+
+	//frees the textures of the cached chunks
+	void ClearChunks();
+	//frees the textures of the chunks that hold the tiles in that range
+	void ClearChunks(int aFirstX, int aFirstY, int aLastX, int aLastY);
+	//frees the textures of the chunks outside of that range of chunks
+	void ClearChunksOutside(int aFirstX, int aFirstY, int aLastX, int aLastY);
 
 	~layer()
 	{
-		delete data;
+		ClearChunks();
+		if (owns_data)
+		{
+			delete[] data;
+		}
 	}
 };
 
@@ -57,6 +127,162 @@ struct background_texture
 };
 
 
+//map elements read from a file but not added to the scene yet
+//parsing a map only fills one of these so it can be done outside of the main thread
+struct staged_tileset
+{
+	int firstgid;
+	int tile_width;
+	int tile_height;
+	int columns;
+	int total_tiles;
+	std::string image;
+};
+
+struct staged_background
+{
+	std::string image;
+	float parallax_x;
+	float parallax_y;
+	int depth;
+	bool repeat_y;
+};
+
+struct staged_layer
+{
+	uint* data;
+	//false when data points inside of the mapped file
+	bool owns_data;
+	int width;
+	int height;
+	float parallax_x;
+	float parallax_y;
+	int depth;
+	//index inside of the staged tilesets
+	uint tileset;
+};
+
+struct staged_object
+{
+	int x;
+	int y;
+	int w;
+	int h;
+	std::string type;
+	std::vector<ObjectProperty> properties;
+};
+
+struct staged_map
+{
+	~staged_map() { Clear(); }
+
+	//frees the tiles and leaves the map empty
+	void Clear()
+	{
+		for (std::vector<staged_layer>::iterator it = layers.begin(); it != layers.end(); ++it)
+		{
+			if ((*it).owns_data)
+			{
+				delete[] (*it).data;
+			}
+		}
+		layers.clear();
+		folder.clear();
+		room_w = 0;
+		room_h = 0;
+		properties.clear();
+		tilesets.clear();
+		backgrounds.clear();
+		walls.clear();
+		objects.clear();
+		file.Close();
+		file_path.clear();
+		parse_time = 0;
+		source_size = -1;
+		compiled_size = -1;
+		error.clear();
+		warnings.clear();
+	}
+
+	std::string folder;
+	int room_w = 0;
+	int room_h = 0;
+
+	std::vector<std::pair<std::string, int>> properties;
+	std::vector<staged_tileset> tilesets;
+	std::vector<staged_background> backgrounds;
+	std::vector<staged_layer> layers;
+	std::vector<RXRect> walls;
+	std::vector<staged_object> objects;
+
+	//compiled map the layers point into, it moves to the scene with them
+	MappedFile file;
+	//path of the compiled map, a map kept for the cache maps it again for the scene and checks it for changes
+	std::string file_path;
+	//when the files were read, a cached map is parsed again if they changed afterwards
+	time_t parse_time = 0;
+	//sizes of the map file and of the compiled one when they were read, -1 if there was none
+	long long source_size = -1;
+	long long compiled_size = -1;
+
+	//filled by the parser, it can't log outside of the main thread
+	std::string error;
+	std::vector<std::string> warnings;
+};
+
+enum stream_region_state
+{
+	REGION_UNLOADED,
+	//its tiles are being read by the prefetching thread
+	REGION_PREFETCHING,
+	//waiting for its turn to add its walls and objects
+	REGION_READY,
+	REGION_LOADED
+};
+
+//part of a streamed map, only the regions around the camera have their walls and objects in the scene
+struct stream_region
+{
+	stream_region_state state = REGION_UNLOADED;
+	//walls that overlap the region and objects placed inside of it, indices inside of the streamed records
+	std::vector<uint> walls;
+	std::vector<uint> objects;
+};
+
+struct streamed_wall
+{
+	RXRect rect;
+	//id inside of the object manager, -1 while no region that has it is loaded
+	int id = -1;
+	//loaded regions that overlap the wall
+	int users = 0;
+};
+
+struct streamed_object
+{
+	staged_object record;
+	//object spawned from the record, it is not spawned again while it is alive
+	ObjectHandle handle = 0;
+};
+
+struct cached_map
+{
+	std::string path;
+	staged_map* map;
+	//memory taken by its tiles
+	unsigned long long bytes;
+};
+
+enum map_load_state
+{
+	MAP_LOAD_IDLE,
+	//the map is being parsed in the loading thread
+	MAP_LOAD_PARSING,
+	//waiting for the decoding pool to finish the textures of the map
+	MAP_LOAD_TEXTURES
+};
+
+
 class SceneController::SceneControllerImpl : public Part::Part_Impl
 {
 public:
@@ -68,27 +294,123 @@ public:
 	}
 
 protected:
+	bool LoadConfig(pugi::xml_node&);
+	bool CreateConfig(pugi::xml_node&);
+
+	//swaps in the maps that are ready before any part draws the frame
+	bool PreLoop();
 	bool Loop(float dt);
 	bool CleanUp();
 
 private:
 
 	bool LoadBackground(pugi::xml_node&);
-	bool LoadWalls(pugi::xml_node&);
-	bool LoadObjects(pugi::xml_node&);
-	bool LoadTiles(pugi::xml_node&);
 
-	bool LoadTilesets(pugi::xml_node&, const char* aMapFolder);
-	bool LoadBackgroundImage(pugi::xml_node&, const char* aMapFolder);
+	//the parsing functions only touch the staged map, they are safe outside of the main thread
+	bool LoadWalls(pugi::xml_node&, staged_map& aMap);
+	bool LoadObjects(pugi::xml_node&, staged_map& aMap);
+	bool LoadTiles(pugi::xml_node&, staged_map& aMap);
+	bool LoadTilesets(pugi::xml_node&, staged_map& aMap);
+	bool LoadBackgroundImage(pugi::xml_node&, staged_map& aMap);
+	void LoadMapProperties(pugi::xml_node&, staged_map& aMap);
 
 	bool LoadMapExecute(const char* filename);
-	void LoadMapProperties(pugi::xml_node&);
+	//reads the compiled map if there is one up to date or the xml one, aProgress goes up to MAP_LOAD_PARSED_PROGRESS
+	bool ParseMap(const char* filename, staged_map& aMap, std::atomic<int>* aProgress);
+	bool LoadXmlMap(const char* filename, staged_map& aMap, std::atomic<int>* aProgress);
+
+	//returns the compiled version of the map if there is one up to date, empty otherwise
+	std::string FindCompiledMap(const char* filename, staged_map& aMap);
+	//maps a map compiled by the MapCompiler tool, the layers use the tiles inside of the file directly
+	bool LoadCompiledMap(const char* filename, staged_map& aMap);
+
+	//replaces the active map with a staged one, main thread only
+	//a kept map is left as it was so it can be applied again, the scene gets its own copy of the tiles
+	void ApplyStagedMap(staged_map& aMap, bool aKeep);
+	void AddTileset(const staged_tileset& aTileset, const char* aMapFolder);
+	void AddBackground(const staged_background& aBackground, const char* aMapFolder);
+	//returns nullptr if there is no factory for that type
+	GameObject* SpawnMapObject(int x, int y, int w, int h, const char* aType, std::list<ObjectProperty*>& aProperties);
+	GameObject* SpawnMapObject(const staged_object& aObject);
+	void ApplyMapProperty(const std::string& aName, int aValue);
+
+	//starts parsing a map in the loading thread, a load already going on is thrown away
+	void StartAsyncLoad(const char* filename);
+	//moves the background load forward, the map is swapped in once it is parsed and its textures are ready
+	void UpdateAsyncLoad();
+	//waits for the loading thread and throws away whatever it loaded
+	void DiscardAsyncLoad();
+
+	//takes the map out of the cache, nullptr if it is not there or its files changed since it was parsed
+	staged_map* TakeCachedMap(const char* filename);
+	//puts the map first in the cache, the least recently used ones are freed when it is full
+	//the tiles of compiled maps are copied out of the file so the cache doesn't keep it open
+	void CacheMap(const char* filename, staged_map* aMap);
+	void ClearMapCache();
+	//moves the maps parsed by the preloader into the cache
+	void CollectPreloadedMaps();
+
+	//takes the walls and objects of the map and adds them by region from now on
+	void StartStreaming(staged_map& aMap);
+	void StopStreaming();
+	//loads the regions around the camera and unloads the ones that are too far
+	void UpdateStreaming();
+	//loads the regions within the radius of the area right away, without prefetching or a budget
+	void LoadRegionsAround(const RXRect& aArea);
+	void LoadRegion(int aRegion);
+	void UnloadRegion(int aRegion);
+	//deletes the streamed objects that are not inside of a loaded region anymore
+	void DespawnStreamedObjects();
+	//index of the region that has that point, points outside of the map use the closest region
+	int GetRegionAt(int x, int y);
 
 	int room_w;
 	int room_h;
 
 	std::string lMapToLoad;
 
+	//background loading
+	map_load_state mLoadState = MAP_LOAD_IDLE;
+	std::thread mLoadThread;
+	staged_map* mStagedMap = nullptr;
+	//set by the loading thread when it is done with the staged map
+	std::atomic<bool> mStagedParsed{ false };
+	//0 to 100, written by the loading thread while parsing
+	std::atomic<int> mLoadProgress{ 0 };
+	std::vector<TextureID> mStagedTextures;
+	//path the staged map is cached with once it is applied
+	std::string mStagedPath;
+
+	//streaming, maps with the "streaming" property only keep the regions around the camera
+	int mStreamRegionSize = STREAMING_DEFAULT_REGION_SIZE;
+	int mStreamRadius = STREAMING_DEFAULT_RADIUS;
+	int mStreamRegionsPerFrame = STREAMING_DEFAULT_REGIONS_PER_FRAME;
+	bool mStreaming = false;
+	//the camera hasn't moved to the new map yet, the first update doesn't unload anything
+	bool mStreamFirstUpdate = false;
+	//size of a region in pixels and in tiles
+	int mRegionW = 0;
+	int mRegionH = 0;
+	int mRegionTiles = 0;
+	int mRegionsX = 0;
+	int mRegionsY = 0;
+	std::vector<stream_region> mRegions;
+	std::vector<streamed_wall> mStreamedWalls;
+	std::vector<streamed_object> mStreamedObjects;
+	//records whose objects may still be alive
+	std::vector<uint> mLiveStreamedObjects;
+	RegionPrefetcher mPrefetcher;
+
+	//most recently used first
+	std::list<cached_map> mMapCache;
+	int mMapCacheSize = MAP_CACHE_DEFAULT_SIZE;
+	unsigned long long mMapCacheMaxBytes = (unsigned long long)MAP_CACHE_DEFAULT_MAX_MB * 1024 * 1024;
+	unsigned long long mMapCacheBytes = 0;
+	MapPreloader mPreloader;
+
+	//file of the active map when it was compiled, the layers point inside of it
+	MappedFile mMapFile;
+
 	//SAME ALL MAPS
 	std::vector<background_texture*>backgrounds;
 	std::vector<tileset*> tilesets;
@@ -0,0 +1,86 @@
+#include "RXpch.h"
+#include "ShapeCast.h"
+
+bool SweepRectVsRect(float aX, float aY, int aW, int aH, float aDX, float aDY, const RXRect& aTarget, float& aFraction, float& aNormalX, float& aNormalY)
+{
+	if (aTarget.w <= 0 || aTarget.h <= 0)
+	{
+		return false;
+	}
+
+	//growing the target by the size of the rect turns the sweep into a ray from its corner
+	float lMinX = aTarget.x - aW;
+	float lMaxX = (float)aTarget.x + aTarget.w;
+	float lMinY = aTarget.y - aH;
+	float lMaxY = (float)aTarget.y + aTarget.h;
+
+	float lEnter = 0;
+	float lExit = 1;
+	float lNormalX = 0;
+	float lNormalY = 0;
+
+	//slab test, one axis at a time
+	if (aDX == 0)
+	{
+		if (aX <= lMinX || aX >= lMaxX)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		float lNear = ((aDX > 0 ? lMinX : lMaxX) - aX) / aDX;
+		float lFar = ((aDX > 0 ? lMaxX : lMinX) - aX) / aDX;
+		if (lNear > lEnter)
+		{
+			lEnter = lNear;
+			lNormalX = aDX > 0 ? -1.0f : 1.0f;
+		}
+		lExit = min(lExit, lFar);
+	}
+
+	if (aDY == 0)
+	{
+		if (aY <= lMinY || aY >= lMaxY)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		float lNear = ((aDY > 0 ? lMinY : lMaxY) - aY) / aDY;
+		float lFar = ((aDY > 0 ? lMaxY : lMinY) - aY) / aDY;
+		if (lNear > lEnter)
+		{
+			lEnter = lNear;
+			lNormalX = 0;
+			lNormalY = aDY > 0 ? -1.0f : 1.0f;
+		}
+		lExit = min(lExit, lFar);
+	}
+
+	//touching an edge without going in is not a hit
+	if (lEnter >= lExit)
+	{
+		return false;
+	}
+
+	aFraction = lEnter;
+	aNormalX = lNormalX;
+	aNormalY = lNormalY;
+	return true;
+}
+
+bool CircleOverlapsRect(float aX, float aY, float aRadius, const RXRect& aRect)
+{
+	if (aRect.w <= 0 || aRect.h <= 0)
+	{
+		return false;
+	}
+
+	float lClosestX = max((float)aRect.x, min(aX, (float)(aRect.x + aRect.w)));
+	float lClosestY = max((float)aRect.y, min(aY, (float)(aRect.y + aRect.h)));
+	float lDistX = aX - lClosestX;
+	float lDistY = aY - lClosestY;
+	return lDistX * lDistX + lDistY * lDistY < aRadius * aRadius;
+}
@@ -0,0 +1,14 @@
+#ifndef SHAPE_CAST__H
+#define SHAPE_CAST__H
+
+#include "RXRect.h"
+
+/*moves a rect of aW x aH from (aX, aY) by (aDX, aDY) against a target rect
+returns true if they touch during the movement, aFraction is how much of the movement was done before touching
+and the normal points out of the face of the target that was hit, 0,0 if the rect started inside of it*/
+bool SweepRectVsRect(float aX, float aY, int aW, int aH, float aDX, float aDY, const RXRect& aTarget, float& aFraction, float& aNormalX, float& aNormalY);
+
+//returns true if the circle overlaps the rect
+bool CircleOverlapsRect(float aX, float aY, float aRadius, const RXRect& aRect);
+
+#endif // !SHAPE_CAST__H
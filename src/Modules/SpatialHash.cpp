@@ -0,0 +1,353 @@
+#include "RXpch.h"
+#include "SpatialHash.h"
+#include "EngineElements/GameObject.h"
+#include "Modules/ObjectManager.h"
+
+//rounds towards negative infinity so negative coordinates get their own cells
+static inline int FloorDiv(int aValue, int aDivisor)
+{
+	int lResult = aValue / aDivisor;
+	if ((aValue % aDivisor != 0) && ((aValue < 0) != (aDivisor < 0)))
+	{
+		--lResult;
+	}
+	return lResult;
+}
+
+void SpatialHash::SetCellSize(int aCellSize)
+{
+	if (aCellSize <= 0)
+	{
+		aCellSize = SPATIAL_HASH_DEFAULT_CELL_SIZE;
+	}
+	if (aCellSize == mCellSize)
+	{
+		return;
+	}
+
+	mCellSize = aCellSize;
+
+	//every object has to be placed again with the new size
+	mCells.clear();
+	for (unsigned int i = 0; i < mEntries.size(); ++i)
+	{
+		if (mEntries[i].object != nullptr)
+		{
+			mEntries[i].cells = GetCellRange(mEntries[i].object->collider);
+			AddToCells(i);
+		}
+	}
+}
+
+SpatialHash::cell_range SpatialHash::GetCellRange(const RXRect& aRect)
+{
+	//empty colliders still take one cell so they are found once they grow
+	cell_range lRange;
+	lRange.min_x = FloorDiv(aRect.x, mCellSize);
+	lRange.min_y = FloorDiv(aRect.y, mCellSize);
+	lRange.max_x = FloorDiv(aRect.x + max(aRect.w, 1) - 1, mCellSize);
+	lRange.max_y = FloorDiv(aRect.y + max(aRect.h, 1) - 1, mCellSize);
+	return lRange;
+}
+
+unsigned long long SpatialHash::GetCellKey(int aX, int aY)
+{
+	return ((unsigned long long)(unsigned int)aX << 32) | (unsigned int)aY;
+}
+
+void SpatialHash::AddToCells(unsigned int aEntry)
+{
+	const cell_range& lRange = mEntries[aEntry].cells;
+	for (int y = lRange.min_y; y <= lRange.max_y; ++y)
+	{
+		for (int x = lRange.min_x; x <= lRange.max_x; ++x)
+		{
+			mCells[GetCellKey(x, y)].push_back(aEntry);
+		}
+	}
+}
+
+void SpatialHash::RemoveFromCells(unsigned int aEntry)
+{
+	const cell_range& lRange = mEntries[aEntry].cells;
+	for (int y = lRange.min_y; y <= lRange.max_y; ++y)
+	{
+		for (int x = lRange.min_x; x <= lRange.max_x; ++x)
+		{
+			std::unordered_map<unsigned long long, std::vector<unsigned int>>::iterator lCell = mCells.find(GetCellKey(x, y));
+			if (lCell == mCells.end())
+			{
+				continue;
+			}
+
+			std::vector<unsigned int>& lList = lCell->second;
+			std::vector<unsigned int>::iterator it = std::find(lList.begin(), lList.end(), aEntry);
+			if (it != lList.end())
+			{
+				//the order inside of a cell doesn't matter
+				*it = lList.back();
+				lList.pop_back();
+			}
+			if (lList.empty())
+			{
+				mCells.erase(lCell);
+			}
+		}
+	}
+}
+
+void SpatialHash::Insert(GameObject* aObject)
+{
+	if (aObject == nullptr || mIndices.find(aObject) != mIndices.end())
+	{
+		return;
+	}
+
+	unsigned int lEntry;
+	if (!mFreeEntries.empty())
+	{
+		lEntry = mFreeEntries.back();
+		mFreeEntries.pop_back();
+	}
+	else
+	{
+		lEntry = mEntries.size();
+		mEntries.push_back(grid_entry());
+	}
+
+	mEntries[lEntry].object = aObject;
+	mEntries[lEntry].cells = GetCellRange(aObject->collider);
+	mEntries[lEntry].query_stamp = 0;
+	mIndices[aObject] = lEntry;
+
+	AddToCells(lEntry);
+}
+
+void SpatialHash::Remove(GameObject* aObject)
+{
+	std::unordered_map<GameObject*, unsigned int>::iterator it = mIndices.find(aObject);
+	if (it == mIndices.end())
+	{
+		return;
+	}
+
+	unsigned int lEntry = it->second;
+	RemoveFromCells(lEntry);
+	mEntries[lEntry].object = nullptr;
+	mFreeEntries.push_back(lEntry);
+	mIndices.erase(it);
+}
+
+bool SpatialHash::Update(GameObject* aObject)
+{
+	std::unordered_map<GameObject*, unsigned int>::iterator it = mIndices.find(aObject);
+	if (it == mIndices.end())
+	{
+		return false;
+	}
+
+	unsigned int lEntry = it->second;
+	cell_range lNewRange = GetCellRange(aObject->collider);
+
+	//moving inside of the same cells costs nothing
+	if (lNewRange == mEntries[lEntry].cells)
+	{
+		return true;
+	}
+
+	RemoveFromCells(lEntry);
+	mEntries[lEntry].cells = lNewRange;
+	AddToCells(lEntry);
+	return true;
+}
+
+void SpatialHash::Update(const std::vector<GameObject*>& aObjects)
+{
+	for (std::vector<GameObject*>::const_iterator it = aObjects.begin(); it != aObjects.end(); ++it)
+	{
+		Update(*it);
+	}
+}
+
+bool SpatialHash::HasMoved(GameObject* aObject)
+{
+	std::unordered_map<GameObject*, unsigned int>::const_iterator it = mIndices.find(aObject);
+	if (it == mIndices.end())
+	{
+		return false;
+	}
+	return !(GetCellRange(aObject->collider) == mEntries[it->second].cells);
+}
+
+void SpatialHash::UpdateAll()
+{
+	for (std::vector<grid_entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if ((*it).object != nullptr)
+		{
+			Update((*it).object);
+		}
+	}
+}
+
+void SpatialHash::Clear()
+{
+	mCells.clear();
+	mEntries.clear();
+	mFreeEntries.clear();
+	mIndices.clear();
+	mQueryStamp = 0;
+}
+
+void SpatialHash::Query(const RXRect& aRect, std::vector<GameObject*>& aResult, unsigned int aMask, bool aConcurrent)
+{
+	if (aRect.w <= 0 || aRect.h <= 0)
+	{
+		return;
+	}
+
+	if (aConcurrent)
+	{
+		QueryConcurrent(aRect, aResult, aMask);
+		return;
+	}
+
+	NextQueryStamp();
+
+	cell_range lRange = GetCellRange(aRect);
+	for (int y = lRange.min_y; y <= lRange.max_y; ++y)
+	{
+		for (int x = lRange.min_x; x <= lRange.max_x; ++x)
+		{
+			std::unordered_map<unsigned long long, std::vector<unsigned int>>::iterator lCell = mCells.find(GetCellKey(x, y));
+			if (lCell == mCells.end())
+			{
+				continue;
+			}
+
+			for (std::vector<unsigned int>::iterator it = lCell->second.begin(); it != lCell->second.end(); ++it)
+			{
+				grid_entry& lEntry = mEntries[*it];
+				if (lEntry.query_stamp == mQueryStamp)
+				{
+					continue;
+				}
+				lEntry.query_stamp = mQueryStamp;
+
+				if ((lEntry.object->collision_layer & aMask) != 0 && RXRectCollision(&lEntry.object->collider, &aRect))
+				{
+					aResult.push_back(lEntry.object);
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::QueryCells(const RXRect& aRect, std::vector<GameObject*>& aResult)
+{
+	NextQueryStamp();
+
+	cell_range lRange = GetCellRange(aRect);
+	for (int y = lRange.min_y; y <= lRange.max_y; ++y)
+	{
+		for (int x = lRange.min_x; x <= lRange.max_x; ++x)
+		{
+			std::unordered_map<unsigned long long, std::vector<unsigned int>>::iterator lCell = mCells.find(GetCellKey(x, y));
+			if (lCell == mCells.end())
+			{
+				continue;
+			}
+
+			for (std::vector<unsigned int>::iterator it = lCell->second.begin(); it != lCell->second.end(); ++it)
+			{
+				grid_entry& lEntry = mEntries[*it];
+				if (lEntry.query_stamp != mQueryStamp)
+				{
+					lEntry.query_stamp = mQueryStamp;
+					aResult.push_back(lEntry.object);
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::NextQueryStamp()
+{
+	if (++mQueryStamp == 0)
+	{
+		//the stamp wrapped around, old stamps could match again
+		for (std::vector<grid_entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+		{
+			(*it).query_stamp = 0;
+		}
+		mQueryStamp = 1;
+	}
+}
+
+void SpatialHash::QueryConcurrent(const RXRect& aRect, std::vector<GameObject*>& aResult, unsigned int aMask)
+{
+	size_t lFirst = aResult.size();
+
+	cell_range lRange = GetCellRange(aRect);
+	for (int y = lRange.min_y; y <= lRange.max_y; ++y)
+	{
+		for (int x = lRange.min_x; x <= lRange.max_x; ++x)
+		{
+			std::unordered_map<unsigned long long, std::vector<unsigned int>>::const_iterator lCell = mCells.find(GetCellKey(x, y));
+			if (lCell == mCells.end())
+			{
+				continue;
+			}
+
+			for (std::vector<unsigned int>::const_iterator it = lCell->second.begin(); it != lCell->second.end(); ++it)
+			{
+				GameObject* lObject = mEntries[*it].object;
+				if ((lObject->collision_layer & aMask) != 0 && RXRectCollision(&lObject->collider, &aRect))
+				{
+					aResult.push_back(lObject);
+				}
+			}
+		}
+	}
+
+	//the stamps can't be used from several threads, the duplicates are removed from the results instead
+	std::sort(aResult.begin() + lFirst, aResult.end());
+	aResult.erase(std::unique(aResult.begin() + lFirst, aResult.end()), aResult.end());
+}
+
+void SpatialHash::GeneratePairs(std::vector<collision_pair>& aPairs)
+{
+	for (std::unordered_map<unsigned long long, std::vector<unsigned int>>::iterator lCell = mCells.begin(); lCell != mCells.end(); ++lCell)
+	{
+		std::vector<unsigned int>& lList = lCell->second;
+		for (unsigned int i = 0; i < lList.size(); ++i)
+		{
+			GameObject* lA = mEntries[lList[i]].object;
+			for (unsigned int j = i + 1; j < lList.size(); ++j)
+			{
+				GameObject* lB = mEntries[lList[j]].object;
+
+				if ((lA->collision_layer & lB->collision_mask) == 0 || (lB->collision_layer & lA->collision_mask) == 0)
+				{
+					continue;
+				}
+
+				if (!RXRectCollision(&lA->collider, &lB->collider))
+				{
+					continue;
+				}
+
+				//objects sharing several cells only report the pair in the cell holding the corner of their overlap
+				int lCornerX = FloorDiv(max(lA->collider.x, lB->collider.x), mCellSize);
+				int lCornerY = FloorDiv(max(lA->collider.y, lB->collider.y), mCellSize);
+				if (GetCellKey(lCornerX, lCornerY) != lCell->first)
+				{
+					continue;
+				}
+
+				collision_pair lPair = { lA, lB };
+				aPairs.push_back(lPair);
+			}
+		}
+	}
+}
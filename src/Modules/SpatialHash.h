@@ -0,0 +1,83 @@
+#ifndef SPATIAL_HASH__H
+#define SPATIAL_HASH__H
+
+#include "RXRect.h"
+#include <vector>
+#include <unordered_map>
+
+class GameObject;
+
+struct collision_pair;
+
+#define SPATIAL_HASH_DEFAULT_CELL_SIZE 128
+
+/*uniform grid of object colliders, stored sparsely by cell coordinates
+objects are only moved between cells when their collider leaves the cells they were in*/
+class SpatialHash
+{
+public:
+	void SetCellSize(int aCellSize);
+	int GetCellSize() { return mCellSize; }
+
+	void Insert(GameObject* aObject);
+	void Remove(GameObject* aObject);
+	//moves the object to the cells its collider covers now, returns false if it is not in the grid
+	bool Update(GameObject* aObject);
+	//moves every object of the list, in order
+	void Update(const std::vector<GameObject*>& aObjects);
+	//true if the collider of the object covers other cells than the ones it is in, only reads the grid
+	bool HasMoved(GameObject* aObject);
+	//moves every object whose collider changed
+	void UpdateAll();
+	void Clear();
+
+	//fills the vector with the objects whose collider overlaps the rect and whose layer is in the mask, each object appears once
+	//concurrent queries don't write to the grid so they can run from several threads at once
+	void Query(const RXRect& aRect, std::vector<GameObject*>& aResult, unsigned int aMask = 0xFFFFFFFF, bool aConcurrent = false);
+	//fills the vector with every object in the cells the rect covers, whatever its layer or size, each object appears once
+	void QueryCells(const RXRect& aRect, std::vector<GameObject*>& aResult);
+	//fills the vector with every pair of overlapping objects that can collide, each pair appears once
+	void GeneratePairs(std::vector<collision_pair>& aPairs);
+
+	int GetObjectCount() { return mIndices.size(); }
+
+private:
+	struct cell_range
+	{
+		int min_x;
+		int min_y;
+		int max_x;
+		int max_y;
+
+		bool operator==(const cell_range& aOther) const
+		{
+			return min_x == aOther.min_x && min_y == aOther.min_y && max_x == aOther.max_x && max_y == aOther.max_y;
+		}
+	};
+
+	struct grid_entry
+	{
+		GameObject* object = nullptr;
+		cell_range cells;
+		//last query that returned the object, so objects in several cells are only added once
+		unsigned int query_stamp = 0;
+	};
+
+	cell_range GetCellRange(const RXRect& aRect);
+	void NextQueryStamp();
+	void QueryConcurrent(const RXRect& aRect, std::vector<GameObject*>& aResult, unsigned int aMask);
+	static unsigned long long GetCellKey(int aX, int aY);
+	void AddToCells(unsigned int aEntry);
+	void RemoveFromCells(unsigned int aEntry);
+
+	int mCellSize = SPATIAL_HASH_DEFAULT_CELL_SIZE;
+	unsigned int mQueryStamp = 0;
+
+	//each cell holds indices into mEntries
+	std::unordered_map<unsigned long long, std::vector<unsigned int>> mCells;
+	std::vector<grid_entry> mEntries;
+	std::vector<unsigned int> mFreeEntries;
+	std::unordered_map<GameObject*, unsigned int> mIndices;
+};
+
+#endif // !SPATIAL_HASH__H
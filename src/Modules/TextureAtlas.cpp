@@ -0,0 +1,242 @@
+#include "RXpch.h"
+#include "TextureAtlas.h"
+#include "Utils/Logger.h"
+
+void SkylinePacker::Init(int aWidth, int aHeight)
+{
+	mWidth = aWidth;
+	mHeight = aHeight;
+
+	mSkyline.clear();
+	SkylineNode lFloor = { 0,0,aWidth };
+	mSkyline.push_back(lFloor);
+}
+
+bool SkylinePacker::Fits(int aIndex, int aWidth, int aHeight, int& aY)
+{
+	int lX = mSkyline[aIndex].x;
+	if (lX + aWidth > mWidth)
+	{
+		return false;
+	}
+
+	//the rectangle rests on the highest node it covers
+	int lWidthLeft = aWidth;
+	aY = mSkyline[aIndex].y;
+	for (int i = aIndex; lWidthLeft > 0; ++i)
+	{
+		if (i >= (int)mSkyline.size())
+		{
+			return false;
+		}
+		aY = max(aY, mSkyline[i].y);
+		if (aY + aHeight > mHeight)
+		{
+			return false;
+		}
+		lWidthLeft -= mSkyline[i].width;
+	}
+	return true;
+}
+
+bool SkylinePacker::Insert(int aWidth, int aHeight, int& aX, int& aY)
+{
+	int lBestIndex = -1;
+	int lBestY = mHeight;
+	int lBestWidth = mWidth;
+
+	for (int i = 0; i < (int)mSkyline.size(); ++i)
+	{
+		int lY;
+		if (Fits(i, aWidth, aHeight, lY))
+		{
+			if (lY < lBestY || (lY == lBestY && mSkyline[i].width < lBestWidth))
+			{
+				lBestIndex = i;
+				lBestY = lY;
+				lBestWidth = mSkyline[i].width;
+			}
+		}
+	}
+
+	if (lBestIndex == -1)
+	{
+		return false;
+	}
+
+	aX = mSkyline[lBestIndex].x;
+	aY = lBestY;
+
+	SkylineNode lNode = { aX, aY + aHeight, aWidth };
+	mSkyline.insert(mSkyline.begin() + lBestIndex, lNode);
+
+	//nodes under the new one are shortened or removed
+	for (int i = lBestIndex + 1; i < (int)mSkyline.size();)
+	{
+		int lEnd = mSkyline[i - 1].x + mSkyline[i - 1].width;
+		if (mSkyline[i].x >= lEnd)
+		{
+			break;
+		}
+
+		int lShrink = lEnd - mSkyline[i].x;
+		mSkyline[i].x += lShrink;
+		mSkyline[i].width -= lShrink;
+		if (mSkyline[i].width > 0)
+		{
+			break;
+		}
+		mSkyline.erase(mSkyline.begin() + i);
+	}
+
+	//neighbours at the same height become a single node
+	for (int i = 0; i + 1 < (int)mSkyline.size();)
+	{
+		if (mSkyline[i].y == mSkyline[i + 1].y)
+		{
+			mSkyline[i].width += mSkyline[i + 1].width;
+			mSkyline.erase(mSkyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return true;
+}
+
+void TextureAtlas::Configure(bool aEnabled, int aPageSize, int aMaxTextureSize, int aPadding)
+{
+	mEnabled = aEnabled;
+	mPageSize = aPageSize;
+	mPadding = max(aPadding, 0);
+	//the padding is packed along with every texture
+	mMaxTextureSize = min(aMaxTextureSize, aPageSize - mPadding);
+}
+
+int TextureAtlas::Insert(SDL_Renderer* aRenderer, SDL_Surface* aSurface, SDL_Rect& aArea)
+{
+	if (!mEnabled || aSurface->w > mMaxTextureSize || aSurface->h > mMaxTextureSize)
+	{
+		return -1;
+	}
+
+	SDL_Surface* lConverted = SDL_ConvertSurfaceFormat(aSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+	if (lConverted == nullptr)
+	{
+		return -1;
+	}
+
+	int lPage = -1;
+	int lX, lY;
+	for (int i = 0; i < (int)mPages.size(); ++i)
+	{
+		if (mPages[i].texture != nullptr && mPages[i].packer.Insert(aSurface->w + mPadding, aSurface->h + mPadding, lX, lY))
+		{
+			lPage = i;
+			break;
+		}
+	}
+
+	if (lPage == -1)
+	{
+		//no room left in any page, reuse a freed slot or add a new page
+		for (int i = 0; i < (int)mPages.size(); ++i)
+		{
+			if (mPages[i].texture == nullptr)
+			{
+				lPage = i;
+				break;
+			}
+		}
+		if (lPage == -1)
+		{
+			mPages.push_back(atlas_page());
+			lPage = mPages.size() - 1;
+		}
+
+		atlas_page& lNewPage = mPages[lPage];
+		lNewPage.texture = SDL_CreateTexture(aRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, mPageSize, mPageSize);
+		if (lNewPage.texture == nullptr)
+		{
+			std::string errstr = "Cannot create atlas page. SDL_CreateTexture error: ";
+			errstr += SDL_GetError();
+			Logger::Console_log(LogLevel::LOG_WARN, errstr.c_str());
+			SDL_FreeSurface(lConverted);
+			return -1;
+		}
+		SDL_SetTextureBlendMode(lNewPage.texture, SDL_BLENDMODE_BLEND);
+
+		//static textures start with undefined contents
+		std::vector<Uint32> lEmpty(mPageSize * mPageSize, 0);
+		SDL_UpdateTexture(lNewPage.texture, NULL, lEmpty.data(), mPageSize * sizeof(Uint32));
+
+		lNewPage.packer.Init(mPageSize, mPageSize);
+		if (!lNewPage.packer.Insert(aSurface->w + mPadding, aSurface->h + mPadding, lX, lY))
+		{
+			//the slot of the page is reused by the next new page
+			SDL_DestroyTexture(lNewPage.texture);
+			lNewPage.texture = nullptr;
+			SDL_FreeSurface(lConverted);
+			return -1;
+		}
+	}
+
+	aArea = { lX, lY, aSurface->w, aSurface->h };
+	SDL_UpdateTexture(mPages[lPage].texture, &aArea, lConverted->pixels, lConverted->pitch);
+	SDL_FreeSurface(lConverted);
+
+	++mPages[lPage].users;
+	return lPage;
+}
+
+SDL_Texture* TextureAtlas::GetPageTexture(int aPage)
+{
+	if (aPage < 0 || aPage >= (int)mPages.size())
+	{
+		return nullptr;
+	}
+	return mPages[aPage].texture;
+}
+
+void TextureAtlas::Release(int aPage)
+{
+	if (aPage < 0 || aPage >= (int)mPages.size())
+	{
+		return;
+	}
+
+	atlas_page& lPage = mPages[aPage];
+	if (--lPage.users <= 0)
+	{
+		SDL_DestroyTexture(lPage.texture);
+		lPage.texture = nullptr;
+		lPage.users = 0;
+	}
+}
+
+unsigned long long TextureAtlas::GetResidentBytes()
+{
+	unsigned long long lBytes = 0;
+	for (std::vector<atlas_page>::iterator it = mPages.begin(); it != mPages.end(); ++it)
+	{
+		if ((*it).texture != nullptr)
+		{
+			lBytes += (unsigned long long)mPageSize * mPageSize * sizeof(Uint32);
+		}
+	}
+	return lBytes;
+}
+
+void TextureAtlas::Clear()
+{
+	for (std::vector<atlas_page>::iterator it = mPages.begin(); it != mPages.end(); ++it)
+	{
+		if ((*it).texture != nullptr)
+		{
+			SDL_DestroyTexture((*it).texture);
+		}
+	}
+	mPages.clear();
+}
@@ -0,0 +1,68 @@
+#ifndef TEXTURE_ATLAS__H
+#define TEXTURE_ATLAS__H
+
+#include "SDL/include/SDL.h"
+#include <vector>
+
+#define ATLAS_DEFAULT_PAGE_SIZE 2048
+#define ATLAS_DEFAULT_MAX_TEXTURE_SIZE 256
+#define ATLAS_DEFAULT_PADDING 1
+
+//bottom-left skyline rectangle packer
+class SkylinePacker
+{
+public:
+	void Init(int aWidth, int aHeight);
+	//finds room for a rectangle, returns false when the area is full
+	bool Insert(int aWidth, int aHeight, int& aX, int& aY);
+
+private:
+	struct SkylineNode
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	bool Fits(int aIndex, int aWidth, int aHeight, int& aY);
+
+	std::vector<SkylineNode> mSkyline;
+	int mWidth = 0;
+	int mHeight = 0;
+};
+
+struct atlas_page
+{
+	SDL_Texture* texture = nullptr;
+	SkylinePacker packer;
+	//textures that still live in this page
+	int users = 0;
+};
+
+//packs small images into shared page textures so that fewer textures are created and bound
+class TextureAtlas
+{
+public:
+	void Configure(bool aEnabled, int aPageSize, int aMaxTextureSize, int aPadding);
+
+	//copies the surface into a page and returns the page index, -1 if it has to be a standalone texture
+	int Insert(SDL_Renderer* aRenderer, SDL_Surface* aSurface, SDL_Rect& aArea);
+	SDL_Texture* GetPageTexture(int aPage);
+	//called when a texture inside of a page is destroyed, empty pages are freed
+	void Release(int aPage);
+	void Clear();
+
+	int GetPageCount() { return mPages.size(); }
+	//memory taken by the pages that are alive
+	unsigned long long GetResidentBytes();
+
+private:
+	bool mEnabled = true;
+	int mPageSize = ATLAS_DEFAULT_PAGE_SIZE;
+	int mMaxTextureSize = ATLAS_DEFAULT_MAX_TEXTURE_SIZE;
+	int mPadding = ATLAS_DEFAULT_PADDING;
+
+	std::vector<atlas_page> mPages;
+};
+
+#endif // !TEXTURE_ATLAS__H
@@ -5,6 +5,7 @@
 #include "Utils/Logger.h"
 #include "Utils/Utils.h"
 #include "TexturesImpl.h"
+#include "AssetManifest.h"
 #include "EngineAPI.h"
 
 #include "SDL_image/include/SDL_image.h"
@@ -34,13 +35,20 @@ bool Textures::TexturesImpl::LoadConfig(pugi::xml_node& config_node)
 		ret = false;
 	}
 
-	std::list<std::string> lFiles;
-	GetAllExtensionPathRecursive("","png", lFiles);
-	
-	for (std::list<std::string>::iterator it = lFiles.begin(); it != lFiles.end(); it++)
-	{
-		mPartInst->Load_Texture((*it).c_str());
-	}
+	pugi::xml_node atlas_node = config_node.child("atlas");
+	mAtlas.Configure(atlas_node.attribute("enabled").as_bool(true), atlas_node.attribute("page_size").as_int(ATLAS_DEFAULT_PAGE_SIZE),
+		atlas_node.attribute("max_texture_size").as_int(ATLAS_DEFAULT_MAX_TEXTURE_SIZE), atlas_node.attribute("padding").as_int(ATLAS_DEFAULT_PADDING));
+
+	pugi::xml_node decoding_node = config_node.child("decoding");
+	mDecodeThreads = decoding_node.attribute("threads").as_int(DECODE_POOL_DEFAULT_THREADS);
+	mUploadBudget = decoding_node.attribute("upload_budget_ms").as_float(DECODE_POOL_DEFAULT_UPLOAD_BUDGET);
+	mDecodePool.Start(mDecodeThreads);
+
+	pugi::xml_node memory_node = config_node.child("memory");
+	mMemoryBudget = memory_node.attribute("budget_mb").as_ullong(0) * 1024 * 1024;
+
+	//textures are not loaded here anymore, they are decoded the first time they are used
+	AssetManifest::Get();
 
 	return ret;
 }
@@ -63,44 +71,418 @@ bool Textures::TexturesImpl::CreateConfig(pugi::xml_node& config_node)
 	}
 	pugi::xml_node textures_node = config_node.append_child("textures");
 
+	pugi::xml_node atlas_node = config_node.append_child("atlas");
+	atlas_node.append_attribute("enabled") = true;
+	atlas_node.append_attribute("page_size") = ATLAS_DEFAULT_PAGE_SIZE;
+	atlas_node.append_attribute("max_texture_size") = ATLAS_DEFAULT_MAX_TEXTURE_SIZE;
+	atlas_node.append_attribute("padding") = ATLAS_DEFAULT_PADDING;
+
+	pugi::xml_node decoding_node = config_node.append_child("decoding");
+	decoding_node.append_attribute("threads") = DECODE_POOL_DEFAULT_THREADS;
+	decoding_node.append_attribute("upload_budget_ms") = DECODE_POOL_DEFAULT_UPLOAD_BUDGET;
+	mDecodePool.Start(mDecodeThreads);
+
+	pugi::xml_node memory_node = config_node.append_child("memory");
+	memory_node.append_attribute("budget_mb") = 0;
+
 	return ret;
 }
 
-SDL_Texture* Textures::TexturesImpl::Get_Texture(TextureID id)
+Texture* Textures::TexturesImpl::GetTextureEntry(TextureID id)
+{
+	//the id holds the slot index and the generation it was given on
+	uint lIndex = id & TEXTURE_ID_INDEX_MASK;
+	uint lGeneration = id >> TEXTURE_ID_INDEX_BITS;
+
+	if (lIndex >= mSlots.size())
+	{
+		return nullptr;
+	}
+
+	texture_slot& lSlot = mSlots[lIndex];
+	if (lSlot.texture == nullptr || lSlot.generation != lGeneration)
+	{
+		return nullptr;
+	}
+	return lSlot.texture;
+}
+
+Texture* Textures::TexturesImpl::GetResidentTexture(TextureID id)
 {
-	for (std::vector<Texture*>::iterator it = texture_list.begin(); it != texture_list.end(); it++)
+	Texture* lTexture = GetTextureEntry(id);
+	if (lTexture == nullptr)
 	{
-		if ((*it)->id == id)
+		return nullptr;
+	}
+
+	//textures in the decoding pool are not drawn until they are uploaded
+	if (lTexture->state == TEXTURE_UNLOADED)
+	{
+		DecodeTexture(lTexture);
+	}
+	lTexture->last_used = mFrame;
+	return lTexture;
+}
+
+bool Textures::TexturesImpl::DecodeTexture(Texture* aTexture)
+{
+	std::stringstream lStr;
+	lStr << "Loading texture from: " << aTexture->name;
+	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+
+	SDL_Surface* surface = IMG_Load(aTexture->name.c_str());
+	if (surface == NULL)
+	{
+		std::string lStr = "Could not load surface with path: ";
+		lStr += aTexture->name;
+		lStr += " IMG_Init: ";
+		lStr += IMG_GetError();
+		Logger::Console_log(LogLevel::LOG_ERROR, lStr.c_str());
+		aTexture->state = TEXTURE_FAILED;
+		return false;
+	}
+
+	return UploadSurface(aTexture, surface);
+}
+
+bool Textures::TexturesImpl::UploadSurface(Texture* aTexture, SDL_Surface* aSurface)
+{
+	SDL_Renderer* lRenderer = mPartInst->mApp.GetModule<Render>().GetSDL_Renderer();
+
+	//small images go into a shared page so fewer textures are created and bound
+	SDL_Rect lArea;
+	int lPage = mAtlas.Insert(lRenderer, aSurface, lArea);
+	if (lPage != -1)
+	{
+		aTexture->texture = mAtlas.GetPageTexture(lPage);
+		aTexture->atlas_page = lPage;
+		aTexture->area = lArea;
+	}
+	else
+	{
+		aTexture->texture = SDL_CreateTextureFromSurface(lRenderer, aSurface);
+		aTexture->area = { 0,0,aSurface->w,aSurface->h };
+		if (aTexture->texture == NULL)
 		{
-			return ((*it)->texture);
+			Logger::Console_log(LogLevel::LOG_ERROR, "couldn't make texture from surface");
 		}
+		else
+		{
+			aTexture->bytes = (uint64)aSurface->w * aSurface->h * 4;
+			mStandaloneBytes += aTexture->bytes;
+		}
+	}
+	SDL_FreeSurface(aSurface);
+
+	aTexture->state = aTexture->texture != nullptr ? TEXTURE_RESIDENT : TEXTURE_FAILED;
+	return aTexture->texture != nullptr;
+}
+
+TextureID Textures::TexturesImpl::RegisterTexture(const char* aPath)
+{
+	TextureID lLoaded = FindTexture(aPath);
+	if (lLoaded != 0)
+	{
+		return lLoaded;
 	}
-	return nullptr;
+
+	//only the size is known until the texture is used for the first time
+	SDL_Rect lArea = { 0,0,0,0 };
+	const asset_entry* lEntry = AssetManifest::Get().Find(aPath);
+	if (lEntry != nullptr)
+	{
+		lArea.w = lEntry->width;
+		lArea.h = lEntry->height;
+	}
+	else if (!FileExists(aPath))
+	{
+		std::string lStr = "Could not find texture with path: ";
+		lStr += aPath;
+		Logger::Console_log(LogLevel::LOG_ERROR, lStr.c_str());
+		return 0;
+	}
+
+	return AddTexture(nullptr, aPath, -1, &lArea);
 }
 
-TextureID Textures::TexturesImpl::AddTexture(SDL_Texture* aTextureToAdd, const char* aTextureName)
+void Textures::TexturesImpl::QueueDecode(TextureID aTextureID)
 {
-	++number_of_textures;
-	Texture* new_tex = new Texture(number_of_textures, aTextureName, aTextureToAdd);
+	Texture* lTexture = GetTextureEntry(aTextureID);
+	if (lTexture == nullptr || lTexture->state != TEXTURE_UNLOADED)
+	{
+		return;
+	}
 
-	texture_list.push_back(new_tex);
-	return new_tex->id;
+	lTexture->state = TEXTURE_DECODING;
+	mDecodePool.Push(aTextureID, lTexture->name.c_str());
 }
 
+void Textures::TexturesImpl::FinishDecode(decode_job& aJob)
+{
+	Texture* lTexture = GetTextureEntry(aJob.id);
+
+	//the texture was destroyed while it was being decoded
+	if (lTexture == nullptr || lTexture->state != TEXTURE_DECODING)
+	{
+		if (aJob.surface != nullptr)
+		{
+			SDL_FreeSurface(aJob.surface);
+		}
+		return;
+	}
+
+	if (aJob.surface == nullptr)
+	{
+		std::string lStr = "Could not load surface with path: ";
+		lStr += aJob.path;
+		lStr += " IMG_Init: ";
+		lStr += aJob.error;
+		Logger::Console_log(LogLevel::LOG_ERROR, lStr.c_str());
+		lTexture->state = TEXTURE_FAILED;
+		return;
+	}
+
+	UploadSurface(lTexture, aJob.surface);
+}
+
+void Textures::TexturesImpl::UploadDecoded(float aBudget)
+{
+	decode_job lJob;
+	if (aBudget < 0)
+	{
+		while (mDecodePool.WaitFinished(lJob))
+		{
+			FinishDecode(lJob);
+		}
+		return;
+	}
+
+	std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+	while (mDecodePool.PopFinished(lJob))
+	{
+		FinishDecode(lJob);
+
+		std::chrono::duration<float, std::milli> lElapsed = std::chrono::steady_clock::now() - lStart;
+		if (lElapsed.count() >= aBudget)
+		{
+			break;
+		}
+	}
+}
+
+void Textures::TexturesImpl::EvictTexture(Texture* aTexture)
+{
+	if (aTexture->atlas_page != -1)
+	{
+		mAtlas.Release(aTexture->atlas_page);
+		aTexture->atlas_page = -1;
+	}
+	else
+	{
+		SDL_DestroyTexture(aTexture->texture);
+		mStandaloneBytes -= aTexture->bytes;
+	}
+
+	aTexture->texture = nullptr;
+	aTexture->bytes = 0;
+	aTexture->state = TEXTURE_UNLOADED;
+	mEvictions++;
+}
+
+void Textures::TexturesImpl::EnforceBudget()
+{
+	//only standalone textures give their memory back when evicted, so the budget is checked against them
+	if (mMemoryBudget == 0 || mStandaloneBytes <= mMemoryBudget)
+	{
+		return;
+	}
+
+	//textures requested this frame may already be in the render queue
+	//atlas members stay, their page is only freed once every texture in it is gone
+	std::vector<Texture*> lCandidates;
+	for (std::vector<texture_slot>::iterator it = mSlots.begin(); it != mSlots.end(); ++it)
+	{
+		Texture* lTexture = (*it).texture;
+		if (lTexture != nullptr && lTexture->reloadable && lTexture->state == TEXTURE_RESIDENT && lTexture->atlas_page == -1 && lTexture->last_used != mFrame)
+		{
+			lCandidates.push_back(lTexture);
+		}
+	}
+
+	std::sort(lCandidates.begin(), lCandidates.end(), [](Texture* a, Texture* b) { return a->last_used < b->last_used; });
+
+	for (std::vector<Texture*>::iterator it = lCandidates.begin(); it != lCandidates.end(); ++it)
+	{
+		EvictTexture(*it);
+		if (mStandaloneBytes <= mMemoryBudget)
+		{
+			break;
+		}
+	}
+}
+
+uint64 Textures::TexturesImpl::GetMemoryUsage()
+{
+	return mStandaloneBytes + mAtlas.GetResidentBytes();
+}
+
+bool Textures::TexturesImpl::Loop(float dt)
+{
+	UploadDecoded(mUploadBudget);
+	EnforceBudget();
+	mFrame++;
+	return true;
+}
+
+SDL_Texture* Textures::TexturesImpl::Get_Texture(TextureID id)
+{
+	Texture* lTexture = GetResidentTexture(id);
+	if (lTexture == nullptr)
+	{
+		return nullptr;
+	}
+	return lTexture->texture;
+}
+
+SDL_Texture* Textures::TexturesImpl::Get_Texture(TextureID id, SDL_Rect& aArea)
+{
+	Texture* lTexture = GetResidentTexture(id);
+	if (lTexture == nullptr)
+	{
+		return nullptr;
+	}
+	aArea = lTexture->area;
+	return lTexture->texture;
+}
+
+TextureID Textures::TexturesImpl::AddTexture(SDL_Texture* aTextureToAdd, const char* aTextureName, int aAtlasPage, const SDL_Rect* aArea)
+{
+	SDL_Rect lArea = { 0,0,0,0 };
+	if (aArea != nullptr)
+	{
+		lArea = *aArea;
+	}
+	else if (aTextureToAdd != nullptr)
+	{
+		SDL_QueryTexture(aTextureToAdd, NULL, NULL, &lArea.w, &lArea.h);
+	}
+
+	uint lIndex;
+	if (!mFreeSlots.empty())
+	{
+		lIndex = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		if (mSlots.size() > TEXTURE_ID_INDEX_MASK)
+		{
+			Logger::Console_log(LogLevel::LOG_ERROR, "Too many textures loaded, texture not added");
+			//atlas pages are shared with other textures
+			if (aAtlasPage != -1)
+			{
+				mAtlas.Release(aAtlasPage);
+			}
+			else if (aTextureToAdd != nullptr)
+			{
+				SDL_DestroyTexture(aTextureToAdd);
+			}
+			return 0;
+		}
+		lIndex = mSlots.size();
+		mSlots.push_back(texture_slot());
+	}
+
+	texture_slot& lSlot = mSlots[lIndex];
+	TextureID lId = (lSlot.generation << TEXTURE_ID_INDEX_BITS) | lIndex;
+	lSlot.texture = new Texture(lId, aTextureName, aTextureToAdd, aAtlasPage, lArea);
+	if (aTextureToAdd != nullptr)
+	{
+		lSlot.texture->state = TEXTURE_RESIDENT;
+		if (aAtlasPage == -1)
+		{
+			int lW = 0, lH = 0;
+			SDL_QueryTexture(aTextureToAdd, NULL, NULL, &lW, &lH);
+			lSlot.texture->bytes = (uint64)lW * lH * 4;
+			mStandaloneBytes += lSlot.texture->bytes;
+		}
+	}
+	else
+	{
+		lSlot.texture->reloadable = true;
+	}
+
+	//the first texture added with a name keeps it
+	mPathIndex.insert(std::make_pair(NormalizePath(aTextureName), lId));
+
+	return lId;
+}
+
+TextureID Textures::TexturesImpl::FindTexture(const char* aTextureName)
+{
+	std::unordered_map<std::string, TextureID>::iterator it = mPathIndex.find(NormalizePath(aTextureName));
+	if (it == mPathIndex.end())
+	{
+		return 0;
+	}
+	return it->second;
+}
 
 bool Textures::TexturesImpl::CleanUp()
 {
 	Logger::Console_log(LogLevel::LOG_ERROR, "Freeing textures and Image library");
-	for (std::vector<Texture*>::iterator it = texture_list.begin(); it != texture_list.end(); it++)
+	mDecodePool.Stop();
+	for (std::vector<texture_slot>::iterator it = mSlots.begin(); it != mSlots.end(); it++)
 	{
-		delete(*it);
-
+		delete (*it).texture;
 	}
-	texture_list.clear();
+	mSlots.clear();
+	mFreeSlots.clear();
+	mPathIndex.clear();
+	mAtlas.Clear();
+	mStandaloneBytes = 0;
 	IMG_Quit();
 	return true;
 }
 
+void Textures::TexturesImpl::DestroyTexture(TextureID aTextureID)
+{
+	Texture* lTexture = GetTextureEntry(aTextureID);
+	if (lTexture == nullptr)
+	{
+		return;
+	}
+
+	std::unordered_map<std::string, TextureID>::iterator lPath = mPathIndex.find(NormalizePath(lTexture->name.c_str()));
+	if (lPath != mPathIndex.end() && lPath->second == aTextureID)
+	{
+		mPathIndex.erase(lPath);
+	}
+
+	int lPage = lTexture->atlas_page;
+	if (lPage == -1)
+	{
+		mStandaloneBytes -= lTexture->bytes;
+	}
+	delete lTexture;
+
+	if (lPage != -1)
+	{
+		mAtlas.Release(lPage);
+	}
+
+	//ids handed out for this slot become stale
+	uint lIndex = aTextureID & TEXTURE_ID_INDEX_MASK;
+	texture_slot& lSlot = mSlots[lIndex];
+	lSlot.texture = nullptr;
+	lSlot.generation = (lSlot.generation + 1) & TEXTURE_ID_GENERATION_MASK;
+	if (lSlot.generation == 0)
+	{
+		lSlot.generation = 1;
+	}
+	mFreeSlots.push_back(lIndex);
+}
+
 #pragma endregion
 
 #pragma region PUBLIC API
@@ -114,43 +496,117 @@ TextureID Textures::Load_Texture(const char*path)
 		return 0;
 	}
 
-	for (std::vector<Texture*>::iterator it = lImpl->texture_list.begin(); it != lImpl->texture_list.end(); it++)
+	return lImpl->RegisterTexture(path);
+}
+
+TextureID Textures::Load_Texture_Async(const char* path)
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
 	{
-		if (std::strcmp((*it)->name.c_str(), path) == 0)
-		{
-			return (*it)->id;
-		}
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
 	}
 
-	std::stringstream lStr;
-	lStr << "Loading texture from: " << path;
-	Logger::Console_log(LogLevel::LOG_INFO, lStr.str().c_str());
+	TextureID lId = lImpl->RegisterTexture(path);
+	lImpl->QueueDecode(lId);
+	return lId;
+}
+
+bool Textures::Is_Texture_Ready(TextureID aTextureID)
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return false;
+	}
 
-	SDL_Texture* texture = NULL;
-	SDL_Surface* surface = IMG_Load(path);
+	Texture* lTexture = lImpl->GetTextureEntry(aTextureID);
+	return lTexture != nullptr && lTexture->state == TEXTURE_RESIDENT;
+}
 
-	TextureID lResult = 0;
+bool Textures::Is_Texture_Decoding(TextureID aTextureID)
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return false;
+	}
 
-	if (surface == NULL)
+	Texture* lTexture = lImpl->GetTextureEntry(aTextureID);
+	return lTexture != nullptr && lTexture->state == TEXTURE_DECODING;
+}
+
+void Textures::Load_Textures_And_Wait(const char** paths, int count, TextureID* ids_out)
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
 	{
-		std::string lStr = "Could not load surface with path: ";
-		lStr += path;
-		lStr +=" IMG_Init: ";
-		lStr += IMG_GetError();
-		Logger::Console_log(LogLevel::LOG_ERROR, lStr.c_str());
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return;
 	}
-	else
+
+	for (int i = 0; i < count; ++i)
 	{
-		texture = SDL_CreateTextureFromSurface(mApp.GetModule<Render>().GetSDL_Renderer(),surface);
-		if (texture == NULL)
+		TextureID lId = lImpl->RegisterTexture(paths[i]);
+		lImpl->QueueDecode(lId);
+		if (ids_out != nullptr)
 		{
-			Logger::Console_log(LogLevel::LOG_ERROR, "couldn't make texture from surface");
+			ids_out[i] = lId;
 		}
-		SDL_FreeSurface(surface);
-		
-		lResult = lImpl->AddTexture(texture, path);
 	}
-	return lResult;
+
+	lImpl->UploadDecoded(-1);
+}
+
+int Textures::Get_Pending_Decodes()
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	return lImpl->mDecodePool.GetPendingCount();
+}
+
+uint64 Textures::Get_Texture_Memory_Usage()
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	return lImpl->GetMemoryUsage();
+}
+
+uint64 Textures::Get_Texture_Memory_Budget()
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	return lImpl->mMemoryBudget;
+}
+
+uint Textures::Get_Texture_Evictions()
+{
+	TexturesImpl* lImpl = dynamic_cast<TexturesImpl*>(mPartFuncts);
+	if (!lImpl)
+	{
+		Logger::Console_log(LogLevel::LOG_ERROR, "Wrong format on the implementation class");
+		return 0;
+	}
+
+	return lImpl->mEvictions;
 }
 
 void Textures::Destroy_Texture(const char* texture_to_destroy)
@@ -162,16 +618,11 @@ void Textures::Destroy_Texture(const char* texture_to_destroy)
 		return;
 	}
 
-	for (std::vector<Texture*>::iterator it = lImpl->texture_list.begin(); it != lImpl->texture_list.end(); it++)
+	TextureID lId = lImpl->FindTexture(texture_to_destroy);
+	if (lId != 0)
 	{
-		if ((*it)->name==texture_to_destroy)
-		{
-			delete(*it);
-			lImpl->texture_list.erase(it);
-			return;
-		}
+		lImpl->DestroyTexture(lId);
 	}
-	return;
 }
 
 void Textures::Destroy_Texture(TextureID aTextureID)
@@ -183,16 +634,7 @@ void Textures::Destroy_Texture(TextureID aTextureID)
 		return;
 	}
 
-	for (std::vector<Texture*>::iterator it = lImpl->texture_list.begin(); it != lImpl->texture_list.end(); it++)
-	{
-		if ((*it)->id == aTextureID)
-		{
-			delete(*it);
-			lImpl->texture_list.erase(it);
-			return;
-		}
-	}
-	return;
+	lImpl->DestroyTexture(aTextureID);
 }
 
 #pragma endregion
\ No newline at end of file
@@ -4,17 +4,49 @@
 #include "PartImpl.h"
 #include "../include/Modules/Textures.h"
 #include "SDL_image/include/SDL_image.h"
+#include "TextureAtlas.h"
+#include "ImageDecodePool.h"
+#include <unordered_map>
 
 struct SDL_Texture;
 struct SDL_Surface;
 
+//a TextureID is the slot index in the low bits and the slot generation in the high bits
+#define TEXTURE_ID_INDEX_BITS 20
+#define TEXTURE_ID_INDEX_MASK ((1u << TEXTURE_ID_INDEX_BITS) - 1)
+#define TEXTURE_ID_GENERATION_MASK ((1u << (32 - TEXTURE_ID_INDEX_BITS)) - 1)
+
+enum TextureState
+{
+	//registered but never used
+	TEXTURE_UNLOADED = 0,
+	//queued in the decoding pool
+	TEXTURE_DECODING,
+	TEXTURE_RESIDENT,
+	//decoding failed so it is not tried again
+	TEXTURE_FAILED
+};
+
 struct Texture
 {
-	Texture(TextureID aTexID, const char* aName, SDL_Texture* aTexPoint) : id(aTexID), name(std::string(aName)), texture(aTexPoint) {};
+	Texture(TextureID aTexID, const char* aName, SDL_Texture* aTexPoint, int aAtlasPage, const SDL_Rect& aArea) 
+		: id(aTexID), name(std::string(aName)), texture(aTexPoint), atlas_page(aAtlasPage), area(aArea) {};
 
 	TextureID id;
 	std::string name;
+	//standalone texture or the atlas page that contains it, nullptr until it is first used
 	SDL_Texture* texture;
+	//-1 when the texture is standalone
+	int atlas_page;
+	//area of the texture that holds the image
+	SDL_Rect area;
+	TextureState state = TEXTURE_UNLOADED;
+	//textures loaded from a file can be evicted and loaded again
+	bool reloadable = false;
+	//frame the texture was last requested on
+	uint last_used = 0;
+	//memory taken by the image, atlas pages are counted apart
+	uint64 bytes = 0;
 	bool operator==(const TextureID& t)
 	{
 		if (id == t)
@@ -41,11 +73,22 @@ struct Texture
 
 	~Texture()
 	{
-		SDL_DestroyTexture(texture);
+		//atlas pages are owned by the atlas
+		if (atlas_page == -1 && texture != nullptr)
+		{
+			SDL_DestroyTexture(texture);
+		}
 	}
 };
 
 
+struct texture_slot
+{
+	Texture* texture = nullptr;
+	//starts at 1 so that 0 is never a valid id
+	uint generation = 1;
+};
+
 class Textures::TexturesImpl : public Part::Part_Impl
 {
 public:
@@ -57,15 +100,58 @@ public:
 		mPartInst = aTextures;
 	}
 	SDL_Texture* Get_Texture(TextureID name);
-	TextureID AddTexture(SDL_Texture* aTextureToAdd,const char* aTextureName);
+	//returns the texture and the area of it that holds the image, atlas textures return the page
+	SDL_Texture* Get_Texture(TextureID name, SDL_Rect& aArea);
+	TextureID AddTexture(SDL_Texture* aTextureToAdd,const char* aTextureName, int aAtlasPage = -1, const SDL_Rect* aArea = nullptr);
+	//returns the id of the texture loaded from that path, 0 if there is none
+	TextureID FindTexture(const char* aTextureName);
 protected:
 	bool LoadConfig(pugi::xml_node& config_node);
 	bool CreateConfig(pugi::xml_node& config_node);
+	bool Loop(float dt);
 	bool CleanUp();
 
+	//adds an entry for the path without decoding it, or returns the one that already exists
+	TextureID RegisterTexture(const char* aPath);
+	//queues the texture in the decoding pool if it was never used
+	void QueueDecode(TextureID aTextureID);
+	//creates the textures of the decoded images until aBudget ms have passed, a negative budget waits for every pending image
+	void UploadDecoded(float aBudget);
+	void FinishDecode(decode_job& aJob);
+	bool UploadSurface(Texture* aTexture, SDL_Surface* aSurface);
+
+	//frees the image of the texture, it is loaded again from its path the next time it is used
+	void EvictTexture(Texture* aTexture);
+	//evicts the least recently used standalone textures until their memory is under the budget
+	void EnforceBudget();
+	uint64 GetMemoryUsage();
+
+	Texture* GetTextureEntry(TextureID id);
+	//returns the entry with its image decoded
+	Texture* GetResidentTexture(TextureID id);
+	bool DecodeTexture(Texture* aTexture);
+	void DestroyTexture(TextureID aTextureID);
+
 private:
-	int number_of_textures = 0;
-	std::vector<Texture*> texture_list;
+	//textures indexed by the slot part of their id
+	std::vector<texture_slot> mSlots;
+	std::vector<uint> mFreeSlots;
+	std::unordered_map<std::string, TextureID> mPathIndex;
+
+	//small textures are packed here
+	TextureAtlas mAtlas;
+
+	ImageDecodePool mDecodePool;
+	int mDecodeThreads = DECODE_POOL_DEFAULT_THREADS;
+	//ms per frame spent creating textures from decoded images
+	float mUploadBudget = DECODE_POOL_DEFAULT_UPLOAD_BUDGET;
+
+	//bytes of standalone texture memory allowed, 0 means no limit, atlas pages are not counted
+	uint64 mMemoryBudget = 0;
+	//bytes taken by textures that are not in the atlas
+	uint64 mStandaloneBytes = 0;
+	uint mEvictions = 0;
+	uint mFrame = 0;
 
 	friend class Textures;
 	Textures* mPartInst;
@@ -0,0 +1,645 @@
+//no precompiled header, the MapCompiler tool builds this file too
+#include "TileDecoder.h"
+
+#include <vector>
+#include <cstring>
+
+namespace
+{
+	//values of the base64 characters, -1 for whitespace and -2 for anything else
+	struct base64_table
+	{
+		signed char values[256];
+
+		base64_table()
+		{
+			memset(values, -2, sizeof(values));
+			const char* lAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			for (int i = 0; i < 64; ++i)
+			{
+				values[(unsigned char)lAlphabet[i]] = (signed char)i;
+			}
+			values[' '] = values['\n'] = values['\r'] = values['\t'] = -1;
+		}
+	};
+	const base64_table sBase64;
+
+	//reads the deflate stream from the lowest bit of every byte
+	struct bit_reader
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t pos = 0;
+		uint32_t buffer = 0;
+		int count = 0;
+
+		bit_reader(const unsigned char* aData, size_t aSize) : data(aData), size(aSize) {}
+
+		//past the end of the data zeros are read, the output bounds stop a broken stream
+		void Refill()
+		{
+			while (count <= 24)
+			{
+				uint32_t lByte = pos < size ? data[pos] : 0;
+				++pos;
+				buffer |= lByte << count;
+				count += 8;
+			}
+		}
+
+		uint32_t Peek()
+		{
+			Refill();
+			return buffer;
+		}
+
+		void Consume(int aBits)
+		{
+			buffer >>= aBits;
+			count -= aBits;
+		}
+
+		uint32_t Bits(int aBits)
+		{
+			if (aBits == 0)
+			{
+				return 0;
+			}
+			Refill();
+			uint32_t lValue = buffer & ((1u << aBits) - 1);
+			Consume(aBits);
+			return lValue;
+		}
+
+		//drops the bits left of the current byte and gives back the whole bytes already buffered
+		void AlignToByte()
+		{
+			Consume(count % 8);
+			pos -= count / 8;
+			buffer = 0;
+			count = 0;
+		}
+
+		bool Overrun() { return pos - count / 8 > size; }
+	};
+
+#define HUFFMAN_MAX_BITS 15
+#define HUFFMAN_FAST_BITS 10
+
+	//canonical huffman code, short codes are found with one table lookup
+	struct huffman
+	{
+		short counts[HUFFMAN_MAX_BITS + 1];
+		short symbols[288];
+		//symbol << 4 | length, 0 when the code is longer than the fast bits
+		unsigned short fast[1 << HUFFMAN_FAST_BITS];
+
+		bool Build(const unsigned char* aLengths, int aCount)
+		{
+			memset(counts, 0, sizeof(counts));
+			memset(fast, 0, sizeof(fast));
+			for (int i = 0; i < aCount; ++i)
+			{
+				counts[aLengths[i]]++;
+			}
+			counts[0] = 0;
+
+			//more codes than the lengths allow can't be decoded
+			int lLeft = 1;
+			for (int len = 1; len <= HUFFMAN_MAX_BITS; ++len)
+			{
+				lLeft = (lLeft << 1) - counts[len];
+				if (lLeft < 0)
+				{
+					return false;
+				}
+			}
+
+			short lOffsets[HUFFMAN_MAX_BITS + 2];
+			lOffsets[1] = 0;
+			for (int len = 1; len <= HUFFMAN_MAX_BITS; ++len)
+			{
+				lOffsets[len + 1] = lOffsets[len] + counts[len];
+			}
+			for (int i = 0; i < aCount; ++i)
+			{
+				if (aLengths[i] != 0)
+				{
+					symbols[lOffsets[aLengths[i]]++] = (short)i;
+				}
+			}
+
+			//the codes are stored from their first bit, the stream gives them reversed
+			int lCode = 0;
+			int lIndex = 0;
+			for (int len = 1; len <= HUFFMAN_FAST_BITS; ++len)
+			{
+				for (int i = 0; i < counts[len]; ++i, ++lCode, ++lIndex)
+				{
+					int lReversed = 0;
+					for (int bit = 0; bit < len; ++bit)
+					{
+						lReversed |= ((lCode >> bit) & 1) << (len - 1 - bit);
+					}
+					for (int fill = lReversed; fill < (1 << HUFFMAN_FAST_BITS); fill += 1 << len)
+					{
+						fast[fill] = (unsigned short)((symbols[lIndex] << 4) | len);
+					}
+				}
+				lCode <<= 1;
+			}
+			return true;
+		}
+
+		int Decode(bit_reader& aReader)
+		{
+			uint32_t lBits = aReader.Peek();
+			unsigned short lEntry = fast[lBits & ((1 << HUFFMAN_FAST_BITS) - 1)];
+			if (lEntry != 0)
+			{
+				aReader.Consume(lEntry & 15);
+				return lEntry >> 4;
+			}
+
+			//long code, walked one bit at a time
+			int lCode = 0;
+			int lFirst = 0;
+			int lIndex = 0;
+			for (int len = 1; len <= HUFFMAN_MAX_BITS; ++len)
+			{
+				lCode |= (lBits >> (len - 1)) & 1;
+				int lCount = counts[len];
+				if (lCode - lCount < lFirst)
+				{
+					aReader.Consume(len);
+					return symbols[lIndex + (lCode - lFirst)];
+				}
+				lIndex += lCount;
+				lFirst += lCount;
+				lFirst <<= 1;
+				lCode <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	const short sLengthBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+	const short sLengthExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+	const unsigned short sDistBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+	const short sDistExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+	const unsigned char sCodeLengthOrder[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+	bool InflateCodes(bit_reader& aReader, huffman& aLengths, huffman& aDistances, unsigned char* aOut, size_t aOutSize, size_t& aWritten)
+	{
+		while (true)
+		{
+			int lSymbol = aLengths.Decode(aReader);
+			if (lSymbol < 0)
+			{
+				return false;
+			}
+			if (lSymbol < 256)
+			{
+				if (aWritten >= aOutSize)
+				{
+					return false;
+				}
+				aOut[aWritten++] = (unsigned char)lSymbol;
+				continue;
+			}
+			if (lSymbol == 256)
+			{
+				return true;
+			}
+
+			lSymbol -= 257;
+			if (lSymbol >= 29)
+			{
+				return false;
+			}
+			size_t lLength = sLengthBase[lSymbol] + aReader.Bits(sLengthExtra[lSymbol]);
+
+			int lDistSymbol = aDistances.Decode(aReader);
+			if (lDistSymbol < 0 || lDistSymbol >= 30)
+			{
+				return false;
+			}
+			size_t lDistance = sDistBase[lDistSymbol] + aReader.Bits(sDistExtra[lDistSymbol]);
+			if (lDistance > aWritten || lLength > aOutSize - aWritten)
+			{
+				return false;
+			}
+
+			//the copy can overlap what it writes, byte by byte repeats the pattern
+			unsigned char* lTo = aOut + aWritten;
+			const unsigned char* lFrom = lTo - lDistance;
+			for (size_t i = 0; i < lLength; ++i)
+			{
+				lTo[i] = lFrom[i];
+			}
+			aWritten += lLength;
+		}
+	}
+
+	bool InflateRaw(bit_reader& aReader, unsigned char* aOut, size_t aOutSize, std::string& aError)
+	{
+		huffman lLengths;
+		huffman lDistances;
+		size_t lWritten = 0;
+
+		bool lLast = false;
+		while (!lLast)
+		{
+			lLast = aReader.Bits(1) != 0;
+			uint32_t lType = aReader.Bits(2);
+
+			if (lType == 0)
+			{
+				aReader.AlignToByte();
+				if (aReader.pos + 4 > aReader.size)
+				{
+					aError = "truncated stored block";
+					return false;
+				}
+				const unsigned char* lHeader = aReader.data + aReader.pos;
+				uint32_t lLength = lHeader[0] | (lHeader[1] << 8);
+				uint32_t lComplement = lHeader[2] | (lHeader[3] << 8);
+				aReader.pos += 4;
+				if (lLength != (~lComplement & 0xFFFF) || aReader.pos + lLength > aReader.size || lLength > aOutSize - lWritten)
+				{
+					aError = "broken stored block";
+					return false;
+				}
+				memcpy(aOut + lWritten, aReader.data + aReader.pos, lLength);
+				aReader.pos += lLength;
+				lWritten += lLength;
+			}
+			else if (lType == 1)
+			{
+				unsigned char lCodeLengths[288 + 30];
+				memset(lCodeLengths, 8, 144);
+				memset(lCodeLengths + 144, 9, 112);
+				memset(lCodeLengths + 256, 7, 24);
+				memset(lCodeLengths + 280, 8, 8);
+				memset(lCodeLengths + 288, 5, 30);
+				lLengths.Build(lCodeLengths, 288);
+				lDistances.Build(lCodeLengths + 288, 30);
+				if (!InflateCodes(aReader, lLengths, lDistances, aOut, aOutSize, lWritten))
+				{
+					aError = "broken compressed block";
+					return false;
+				}
+			}
+			else if (lType == 2)
+			{
+				int lLiteralCount = aReader.Bits(5) + 257;
+				int lDistanceCount = aReader.Bits(5) + 1;
+				int lCodeLengthCount = aReader.Bits(4) + 4;
+				if (lLiteralCount > 286 || lDistanceCount > 30)
+				{
+					aError = "too many codes in block";
+					return false;
+				}
+
+				unsigned char lOrderLengths[19] = {};
+				for (int i = 0; i < lCodeLengthCount; ++i)
+				{
+					lOrderLengths[sCodeLengthOrder[i]] = (unsigned char)aReader.Bits(3);
+				}
+				huffman lCodeLengthCode;
+				if (!lCodeLengthCode.Build(lOrderLengths, 19))
+				{
+					aError = "broken code lengths";
+					return false;
+				}
+
+				unsigned char lCodeLengths[286 + 30];
+				int lCount = 0;
+				while (lCount < lLiteralCount + lDistanceCount)
+				{
+					int lSymbol = lCodeLengthCode.Decode(aReader);
+					if (lSymbol < 0)
+					{
+						aError = "broken code lengths";
+						return false;
+					}
+					if (lSymbol < 16)
+					{
+						lCodeLengths[lCount++] = (unsigned char)lSymbol;
+						continue;
+					}
+
+					unsigned char lRepeated = 0;
+					int lRepeat;
+					if (lSymbol == 16)
+					{
+						if (lCount == 0)
+						{
+							aError = "repeated length without a previous one";
+							return false;
+						}
+						lRepeated = lCodeLengths[lCount - 1];
+						lRepeat = 3 + aReader.Bits(2);
+					}
+					else if (lSymbol == 17)
+					{
+						lRepeat = 3 + aReader.Bits(3);
+					}
+					else
+					{
+						lRepeat = 11 + aReader.Bits(7);
+					}
+
+					if (lCount + lRepeat > lLiteralCount + lDistanceCount)
+					{
+						aError = "too many code lengths";
+						return false;
+					}
+					memset(lCodeLengths + lCount, lRepeated, lRepeat);
+					lCount += lRepeat;
+				}
+
+				if (lCodeLengths[256] == 0 || !lLengths.Build(lCodeLengths, lLiteralCount) || !lDistances.Build(lCodeLengths + lLiteralCount, lDistanceCount))
+				{
+					aError = "broken huffman codes";
+					return false;
+				}
+				if (!InflateCodes(aReader, lLengths, lDistances, aOut, aOutSize, lWritten))
+				{
+					aError = "broken compressed block";
+					return false;
+				}
+			}
+			else
+			{
+				aError = "unknown block type";
+				return false;
+			}
+		}
+
+		if (aReader.Overrun())
+		{
+			aError = "truncated stream";
+			return false;
+		}
+		if (lWritten != aOutSize)
+		{
+			aError = "the stream doesn't hold the whole layer";
+			return false;
+		}
+		return true;
+	}
+}
+
+long long DecodeBase64(const char* aText, size_t aLength, unsigned char* aOut, size_t aOutSize)
+{
+	const unsigned char* lText = (const unsigned char*)aText;
+	const unsigned char* lEnd = lText + aLength;
+	size_t lWritten = 0;
+
+	uint32_t lAccumulated = 0;
+	int lSextets = 0;
+	while (lText < lEnd)
+	{
+		//fast path, four valid characters at once
+		if (lSextets == 0 && lEnd - lText >= 4 && lWritten + 3 <= aOutSize)
+		{
+			int a = sBase64.values[lText[0]];
+			int b = sBase64.values[lText[1]];
+			int c = sBase64.values[lText[2]];
+			int d = sBase64.values[lText[3]];
+			if ((a | b | c | d) >= 0)
+			{
+				uint32_t lTriple = (a << 18) | (b << 12) | (c << 6) | d;
+				aOut[lWritten] = (unsigned char)(lTriple >> 16);
+				aOut[lWritten + 1] = (unsigned char)(lTriple >> 8);
+				aOut[lWritten + 2] = (unsigned char)lTriple;
+				lWritten += 3;
+				lText += 4;
+				continue;
+			}
+		}
+
+		unsigned char lChar = *lText++;
+		int lValue = sBase64.values[lChar];
+		if (lValue == -1)
+		{
+			continue;
+		}
+		if (lChar == '=')
+		{
+			break;
+		}
+		if (lValue < 0)
+		{
+			return -1;
+		}
+
+		lAccumulated = (lAccumulated << 6) | lValue;
+		if (++lSextets == 4)
+		{
+			if (lWritten + 3 > aOutSize)
+			{
+				return -1;
+			}
+			aOut[lWritten++] = (unsigned char)(lAccumulated >> 16);
+			aOut[lWritten++] = (unsigned char)(lAccumulated >> 8);
+			aOut[lWritten++] = (unsigned char)lAccumulated;
+			lAccumulated = 0;
+			lSextets = 0;
+		}
+	}
+
+	//the padding leaves one or two bytes in the last group
+	if (lSextets == 1)
+	{
+		return -1;
+	}
+	if (lSextets > 1)
+	{
+		lAccumulated <<= 6 * (4 - lSextets);
+		int lBytes = lSextets - 1;
+		if (lWritten + lBytes > aOutSize)
+		{
+			return -1;
+		}
+		aOut[lWritten++] = (unsigned char)(lAccumulated >> 16);
+		if (lBytes == 2)
+		{
+			aOut[lWritten++] = (unsigned char)(lAccumulated >> 8);
+		}
+	}
+	return (long long)lWritten;
+}
+
+bool Inflate(const unsigned char* aData, size_t aSize, unsigned char* aOut, size_t aOutSize, bool aGzip, std::string& aError)
+{
+	size_t lStart = 0;
+	if (aGzip)
+	{
+		if (aSize < 18 || aData[0] != 0x1F || aData[1] != 0x8B || aData[2] != 8)
+		{
+			aError = "not a gzip stream";
+			return false;
+		}
+		unsigned char lFlags = aData[3];
+		lStart = 10;
+		//extra field, file name, comment and header crc
+		if (lFlags & 4)
+		{
+			if (lStart + 2 > aSize)
+			{
+				aError = "truncated gzip header";
+				return false;
+			}
+			lStart += 2 + (aData[lStart] | (aData[lStart + 1] << 8));
+		}
+		for (int lFlag = 8; lFlag <= 16; lFlag <<= 1)
+		{
+			if (lFlags & lFlag)
+			{
+				while (lStart < aSize && aData[lStart] != 0)
+				{
+					++lStart;
+				}
+				++lStart;
+			}
+		}
+		if (lFlags & 2)
+		{
+			lStart += 2;
+		}
+		if (lStart >= aSize)
+		{
+			aError = "truncated gzip header";
+			return false;
+		}
+	}
+	else
+	{
+		if (aSize < 6 || (aData[0] & 15) != 8 || ((aData[0] << 8) | aData[1]) % 31 != 0 || (aData[1] & 32) != 0)
+		{
+			aError = "not a zlib stream";
+			return false;
+		}
+		lStart = 2;
+	}
+
+	bit_reader lReader(aData + lStart, aSize - lStart);
+	if (!InflateRaw(lReader, aOut, aOutSize, aError))
+	{
+		return false;
+	}
+
+	if (!aGzip)
+	{
+		//adler32 of the output follows the zlib stream, big endian
+		lReader.AlignToByte();
+		if (lReader.pos + 4 > lReader.size)
+		{
+			aError = "missing zlib checksum";
+			return false;
+		}
+		uint32_t a = 1, b = 0;
+		for (size_t i = 0; i < aOutSize; )
+		{
+			//the sums can go 5552 bytes before they overflow
+			size_t lBlockEnd = i + 5552 < aOutSize ? i + 5552 : aOutSize;
+			for (; i < lBlockEnd; ++i)
+			{
+				a += aOut[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		const unsigned char* lSum = lReader.data + lReader.pos;
+		uint32_t lExpected = ((uint32_t)lSum[0] << 24) | (lSum[1] << 16) | (lSum[2] << 8) | lSum[3];
+		if (lExpected != ((b << 16) | a))
+		{
+			aError = "zlib checksum does not match";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool DecodeTileData(const char* aText, const char* aEncoding, const char* aCompression, uint32_t* aTiles, size_t aCount, std::string& aError)
+{
+	if (strcmp(aEncoding, "csv") == 0)
+	{
+		//one pass, every number goes straight into its tile
+		const char* lText = aText;
+		for (size_t i = 0; i < aCount; ++i)
+		{
+			while (*lText == ',' || *lText == ' ' || *lText == '\n' || *lText == '\r' || *lText == '\t')
+			{
+				++lText;
+			}
+			if (*lText < '0' || *lText > '9')
+			{
+				aError = "the csv doesn't hold the whole layer";
+				return false;
+			}
+
+			uint64_t lValue = 0;
+			while (*lText >= '0' && *lText <= '9')
+			{
+				lValue = lValue * 10 + (*lText - '0');
+				++lText;
+			}
+			if (lValue > 0xFFFFFFFF)
+			{
+				aError = "tile gid out of range in csv";
+				return false;
+			}
+			aTiles[i] = (uint32_t)lValue;
+		}
+		return true;
+	}
+
+	if (strcmp(aEncoding, "base64") != 0)
+	{
+		aError = "unknown tile encoding ";
+		aError += aEncoding;
+		return false;
+	}
+
+	size_t lLength = strlen(aText);
+	size_t lBytes = aCount * sizeof(uint32_t);
+	if (aCompression == nullptr || aCompression[0] == '\0')
+	{
+		//without compression the text decodes straight into the tiles
+		if (DecodeBase64(aText, lLength, (unsigned char*)aTiles, lBytes) != (long long)lBytes)
+		{
+			aError = "the base64 doesn't hold the whole layer";
+			return false;
+		}
+		return true;
+	}
+
+	bool lGzip = strcmp(aCompression, "gzip") == 0;
+	if (!lGzip && strcmp(aCompression, "zlib") != 0)
+	{
+		aError = "unsupported tile compression ";
+		aError += aCompression;
+		return false;
+	}
+
+	std::vector<unsigned char> lCompressed(lLength / 4 * 3 + 3);
+	long long lCompressedSize = DecodeBase64(aText, lLength, lCompressed.data(), lCompressed.size());
+	if (lCompressedSize < 0)
+	{
+		aError = "broken base64 in tile data";
+		return false;
+	}
+	return Inflate(lCompressed.data(), (size_t)lCompressedSize, (unsigned char*)aTiles, lBytes, lGzip, aError);
+}
+
+void GidsToTileIds(uint32_t* aTiles, size_t aCount, uint32_t aFirstgid)
+{
+	for (size_t i = 0; i < aCount; ++i)
+	{
+		aTiles[i] = aTiles[i] == 0 ? 0xFFFFFFFF : (aTiles[i] & ~TILE_GID_FLIP_FLAGS) - aFirstgid;
+	}
+}
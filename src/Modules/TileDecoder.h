@@ -0,0 +1,25 @@
+#ifndef TILE_DECODER__H
+#define TILE_DECODER__H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+//top bits of the Tiled gids, they flip the tile and are not part of the id
+#define TILE_GID_FLIP_FLAGS 0xE0000000
+
+/*fills aTiles with the aCount gids written in the text of a Tiled <data> node
+the encoding can be "csv" or "base64", base64 can be compressed with "zlib" or "gzip"
+returns false and fills aError if the encoding is not supported or the data is broken*/
+bool DecodeTileData(const char* aText, const char* aEncoding, const char* aCompression, uint32_t* aTiles, size_t aCount, std::string& aError);
+
+//turns gids into ids inside of the tileset that starts at aFirstgid, 0 becomes the empty tile 0xFFFFFFFF
+void GidsToTileIds(uint32_t* aTiles, size_t aCount, uint32_t aFirstgid);
+
+//decodes base64 text into aOut, whitespace is skipped, returns the number of bytes written or -1 if the text is broken or doesn't fit
+long long DecodeBase64(const char* aText, size_t aLength, unsigned char* aOut, size_t aOutSize);
+
+//decompresses a zlib or gzip stream, it has to fill aOut exactly
+bool Inflate(const unsigned char* aData, size_t aSize, unsigned char* aOut, size_t aOutSize, bool aGzip, std::string& aError);
+
+#endif // !TILE_DECODER__H
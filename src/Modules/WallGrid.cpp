@@ -0,0 +1,172 @@
+#include "RXpch.h"
+#include "WallGrid.h"
+
+void WallGrid::SetCellSize(int aCellSize)
+{
+	mCellSize = aCellSize > 0 ? aCellSize : WALL_GRID_DEFAULT_CELL_SIZE;
+}
+
+void WallGrid::Build(const std::vector<RXRect*>& aWalls)
+{
+	Clear();
+
+	for (std::vector<RXRect*>::const_iterator it = aWalls.begin(); it != aWalls.end(); ++it)
+	{
+		if ((*it) != nullptr && (*it)->w > 0 && (*it)->h > 0)
+		{
+			mWalls.push_back(*it);
+		}
+	}
+
+	if (mWalls.empty())
+	{
+		return;
+	}
+
+	int lMinX = mWalls[0]->x;
+	int lMinY = mWalls[0]->y;
+	int lMaxX = mWalls[0]->x + mWalls[0]->w;
+	int lMaxY = mWalls[0]->y + mWalls[0]->h;
+	for (std::vector<RXRect*>::iterator it = mWalls.begin(); it != mWalls.end(); ++it)
+	{
+		lMinX = min(lMinX, (*it)->x);
+		lMinY = min(lMinY, (*it)->y);
+		lMaxX = max(lMaxX, (*it)->x + (*it)->w);
+		lMaxY = max(lMaxY, (*it)->y + (*it)->h);
+	}
+
+	mOriginX = lMinX;
+	mOriginY = lMinY;
+	mBuiltCellSize = mCellSize;
+	mCellsX = (lMaxX - lMinX + mBuiltCellSize - 1) / mBuiltCellSize;
+	mCellsY = (lMaxY - lMinY + mBuiltCellSize - 1) / mBuiltCellSize;
+	while ((long long)mCellsX * mCellsY > WALL_GRID_MAX_CELLS)
+	{
+		mBuiltCellSize *= 2;
+		mCellsX = (lMaxX - lMinX + mBuiltCellSize - 1) / mBuiltCellSize;
+		mCellsY = (lMaxY - lMinY + mBuiltCellSize - 1) / mBuiltCellSize;
+	}
+
+	//first pass counts the walls of every cell, second pass writes them
+	mCellStart.assign(mCellsX * mCellsY + 1, 0);
+	for (unsigned int i = 0; i < mWalls.size(); ++i)
+	{
+		RXRect* lWall = mWalls[i];
+		int lFirstX = (lWall->x - mOriginX) / mBuiltCellSize;
+		int lFirstY = (lWall->y - mOriginY) / mBuiltCellSize;
+		int lLastX = (lWall->x + lWall->w - 1 - mOriginX) / mBuiltCellSize;
+		int lLastY = (lWall->y + lWall->h - 1 - mOriginY) / mBuiltCellSize;
+		for (int y = lFirstY; y <= lLastY; ++y)
+		{
+			for (int x = lFirstX; x <= lLastX; ++x)
+			{
+				mCellStart[y * mCellsX + x + 1]++;
+			}
+		}
+	}
+
+	for (unsigned int i = 1; i < mCellStart.size(); ++i)
+	{
+		mCellStart[i] += mCellStart[i - 1];
+	}
+
+	mCellWalls.resize(mCellStart.back());
+	std::vector<unsigned int> lFill(mCellStart.begin(), mCellStart.end() - 1);
+	for (unsigned int i = 0; i < mWalls.size(); ++i)
+	{
+		RXRect* lWall = mWalls[i];
+		int lFirstX = (lWall->x - mOriginX) / mBuiltCellSize;
+		int lFirstY = (lWall->y - mOriginY) / mBuiltCellSize;
+		int lLastX = (lWall->x + lWall->w - 1 - mOriginX) / mBuiltCellSize;
+		int lLastY = (lWall->y + lWall->h - 1 - mOriginY) / mBuiltCellSize;
+		for (int y = lFirstY; y <= lLastY; ++y)
+		{
+			for (int x = lFirstX; x <= lLastX; ++x)
+			{
+				mCellWalls[lFill[y * mCellsX + x]++] = i;
+			}
+		}
+	}
+
+	mStamps.assign(mWalls.size(), 0);
+}
+
+void WallGrid::Clear()
+{
+	mCellStart.clear();
+	mCellWalls.clear();
+	mWalls.clear();
+	mStamps.clear();
+	mQueryStamp = 0;
+	mCellsX = 0;
+	mCellsY = 0;
+}
+
+void WallGrid::Query(const RXRect& aArea, std::vector<RXRect*>& aResult, bool aConcurrent)
+{
+	if (mWalls.empty() || aArea.w <= 0 || aArea.h <= 0)
+	{
+		return;
+	}
+
+	//only the cells inside of the grid can hold walls
+	int lFirstX = max((aArea.x - mOriginX) / mBuiltCellSize, 0);
+	int lFirstY = max((aArea.y - mOriginY) / mBuiltCellSize, 0);
+	int lLastX = min((aArea.x + aArea.w - 1 - mOriginX) / mBuiltCellSize, mCellsX - 1);
+	int lLastY = min((aArea.y + aArea.h - 1 - mOriginY) / mBuiltCellSize, mCellsY - 1);
+	if (aArea.x + aArea.w <= mOriginX || aArea.y + aArea.h <= mOriginY || lFirstX > lLastX || lFirstY > lLastY)
+	{
+		return;
+	}
+
+	if (aConcurrent)
+	{
+		//the stamps can't be used from several threads, the duplicates are removed from the results instead
+		size_t lFirst = aResult.size();
+		for (int y = lFirstY; y <= lLastY; ++y)
+		{
+			for (int x = lFirstX; x <= lLastX; ++x)
+			{
+				int lCell = y * mCellsX + x;
+				for (unsigned int i = mCellStart[lCell]; i < mCellStart[lCell + 1]; ++i)
+				{
+					if (RXRectCollision(mWalls[mCellWalls[i]], &aArea))
+					{
+						aResult.push_back(mWalls[mCellWalls[i]]);
+					}
+				}
+			}
+		}
+		std::sort(aResult.begin() + lFirst, aResult.end());
+		aResult.erase(std::unique(aResult.begin() + lFirst, aResult.end()), aResult.end());
+		return;
+	}
+
+	if (++mQueryStamp == 0)
+	{
+		std::fill(mStamps.begin(), mStamps.end(), 0);
+		mQueryStamp = 1;
+	}
+
+	for (int y = lFirstY; y <= lLastY; ++y)
+	{
+		for (int x = lFirstX; x <= lLastX; ++x)
+		{
+			int lCell = y * mCellsX + x;
+			for (unsigned int i = mCellStart[lCell]; i < mCellStart[lCell + 1]; ++i)
+			{
+				unsigned int lWall = mCellWalls[i];
+				if (mStamps[lWall] == mQueryStamp)
+				{
+					continue;
+				}
+				mStamps[lWall] = mQueryStamp;
+
+				if (RXRectCollision(mWalls[lWall], &aArea))
+				{
+					aResult.push_back(mWalls[lWall]);
+				}
+			}
+		}
+	}
+}
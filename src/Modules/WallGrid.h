@@ -0,0 +1,47 @@
+#ifndef WALL_GRID__H
+#define WALL_GRID__H
+
+#include "RXRect.h"
+#include <vector>
+
+#define WALL_GRID_DEFAULT_CELL_SIZE 256
+//the cell size is doubled until the grid has less cells than this
+#define WALL_GRID_MAX_CELLS (1 << 20)
+
+/*grid over the walls of the map, built once after they are loaded and not modified afterwards
+every cell stores the walls that overlap it in one shared array*/
+class WallGrid
+{
+public:
+	void SetCellSize(int aCellSize);
+
+	void Build(const std::vector<RXRect*>& aWalls);
+	void Clear();
+
+	//fills the vector with the walls that overlap the area, each wall appears once
+	//concurrent queries don't write to the grid so they can run from several threads at once
+	void Query(const RXRect& aArea, std::vector<RXRect*>& aResult, bool aConcurrent = false);
+
+	int GetWallCount() { return mWalls.size(); }
+
+private:
+	int mCellSize = WALL_GRID_DEFAULT_CELL_SIZE;
+	//size used by the current grid, it can be bigger than the configured one
+	int mBuiltCellSize = WALL_GRID_DEFAULT_CELL_SIZE;
+
+	int mOriginX = 0;
+	int mOriginY = 0;
+	int mCellsX = 0;
+	int mCellsY = 0;
+
+	//the walls of cell i are mCellWalls[mCellStart[i]] to mCellWalls[mCellStart[i + 1]]
+	std::vector<unsigned int> mCellStart;
+	std::vector<unsigned int> mCellWalls;
+	std::vector<RXRect*> mWalls;
+
+	//last query that returned each wall, so walls in several cells are only added once
+	std::vector<unsigned int> mStamps;
+	unsigned int mQueryStamp = 0;
+};
+
+#endif // !WALL_GRID__H
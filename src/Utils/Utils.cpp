@@ -1,4 +1,6 @@
 #include "Utils/Utils.h"
+#include <vector>
+#include <cctype>
 
 bool FileExists(const std::string& name) {
 	struct stat buffer;
@@ -33,7 +35,11 @@ void GetAllExtensionPathRecursive(const char* path, const char* extension, std::
 	std::wstring conver((const wchar_t*)&pwd[0], sizeof(pwd) / sizeof(pwd[0])); //convert to wstring
 	std::string fulldir(conver.begin(), conver.end());
 
-	fulldir += path;
+	if (path[0] != '\0')
+	{
+		fulldir += "\\";
+		fulldir += path;
+	}
 	fulldir += "\\*";
 
 	if ((hFind = FindFirstFileA(fulldir.c_str(), &fdFile)) == INVALID_HANDLE_VALUE)
@@ -52,7 +58,10 @@ void GetAllExtensionPathRecursive(const char* path, const char* extension, std::
 			if (fdFile.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 			{
 				std::string folder_rel = path;
-				folder_rel += "\\";
+				if (!folder_rel.empty())
+				{
+					folder_rel += "\\";
+				}
 				folder_rel += fdFile.cFileName;
 
 				GetAllExtensionPathRecursive(folder_rel.c_str(), extension, listToFill);
@@ -63,7 +72,14 @@ void GetAllExtensionPathRecursive(const char* path, const char* extension, std::
 
 				if (s.substr(s.find_last_of(".") + 1) == extension)
 				{
-					listToFill.push_back(s);
+					//paths are relative to the working directory so they can be loaded directly
+					std::string file_rel = path;
+					if (!file_rel.empty())
+					{
+						file_rel += "\\";
+					}
+					file_rel += s;
+					listToFill.push_back(file_rel);
 				}
 			}
 		}
@@ -74,6 +90,57 @@ void GetAllExtensionPathRecursive(const char* path, const char* extension, std::
 
 }
 
+std::string NormalizePath(const char* aPath)
+{
+	std::vector<std::string> lParts;
+	std::string lCurrent;
+
+	for (const char* c = aPath; ; ++c)
+	{
+		if (*c == '\\' || *c == '/' || *c == '\0')
+		{
+			if (lCurrent == "..")
+			{
+				//a parent folder cancels the previous folder if there is one to cancel
+				if (!lParts.empty() && lParts.back() != "..")
+				{
+					lParts.pop_back();
+				}
+				else
+				{
+					lParts.push_back(lCurrent);
+				}
+			}
+			else if (!lCurrent.empty() && lCurrent != ".")
+			{
+				lParts.push_back(lCurrent);
+			}
+			lCurrent.clear();
+
+			if (*c == '\0')
+			{
+				break;
+			}
+		}
+		else
+		{
+			//the file system is not case sensitive
+			lCurrent += (char)tolower((unsigned char)*c);
+		}
+	}
+
+	std::string lResult;
+	for (std::vector<std::string>::iterator it = lParts.begin(); it != lParts.end(); ++it)
+	{
+		if (!lResult.empty())
+		{
+			lResult += '/';
+		}
+		lResult += (*it);
+	}
+	return lResult;
+}
+
 float GetQueueMedianNumber(std::queue<float> lQueue)
 {
 	float lSumOfallTimes = 0;
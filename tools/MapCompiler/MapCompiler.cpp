@@ -0,0 +1,431 @@
+//offline tool that turns Tiled maps into the compiled format the engine maps straight into memory
+//usage: MapCompiler map.tmx [map.rxmap]
+
+#include "pugiXML/src/pugixml.hpp"
+#include "../../src/Modules/MapFormat.h"
+#include "../../src/Modules/TileDecoder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class MapWriter
+{
+public:
+	MapWriter()
+	{
+		//offset 0 is the empty string
+		mStrings.push_back('\0');
+	}
+
+	bool Compile(const char* aTmxPath);
+	bool Save(const char* aOutputPath);
+
+private:
+	uint32_t AddString(const char* aString);
+	void AddProperty(pugi::xml_node& aProperty);
+
+	void CompileTileset(pugi::xml_node& aNode);
+	void CompileBackground(pugi::xml_node& aNode);
+	void CompileWalls(pugi::xml_node& aNode);
+	void CompileObjects(pugi::xml_node& aNode);
+	bool CompileLayer(pugi::xml_node& aNode);
+	void CompileMapProperties(pugi::xml_node& aNode);
+
+	std::vector<map_file_tileset> mTilesets;
+	std::vector<map_file_layer> mLayers;
+	std::vector<std::vector<uint32_t>> mLayerData;
+	std::vector<map_file_background> mBackgrounds;
+	std::vector<map_file_wall> mWalls;
+	std::vector<map_file_object> mObjects;
+	std::vector<map_file_property> mProperties;
+	uint32_t mMapPropertyFirst = 0;
+	uint32_t mMapPropertyCount = 0;
+
+	std::vector<char> mStrings;
+	std::unordered_map<std::string, uint32_t> mStringOffsets;
+};
+
+uint32_t MapWriter::AddString(const char* aString)
+{
+	if (aString == nullptr || aString[0] == '\0')
+	{
+		return 0;
+	}
+
+	std::unordered_map<std::string, uint32_t>::iterator it = mStringOffsets.find(aString);
+	if (it != mStringOffsets.end())
+	{
+		return it->second;
+	}
+
+	uint32_t lOffset = (uint32_t)mStrings.size();
+	mStrings.insert(mStrings.end(), aString, aString + strlen(aString) + 1);
+	mStringOffsets[aString] = lOffset;
+	return lOffset;
+}
+
+void MapWriter::AddProperty(pugi::xml_node& aProperty)
+{
+	map_file_property lProperty = {};
+	lProperty.name = AddString(aProperty.attribute("name").as_string());
+
+	std::string lType = aProperty.attribute("type").as_string();
+	if (lType == "bool")
+	{
+		lProperty.type = MAP_PROPERTY_BOOL;
+	}
+	else if (lType == "float")
+	{
+		lProperty.type = MAP_PROPERTY_FLOAT;
+	}
+	else if (lType == "int")
+	{
+		lProperty.type = MAP_PROPERTY_INT;
+	}
+	else if (strcmp(aProperty.attribute("value").as_string(""), "") != 0)
+	{
+		lProperty.type = MAP_PROPERTY_STRING;
+	}
+	else
+	{
+		lProperty.type = MAP_PROPERTY_NONE;
+	}
+
+	//every value is kept so the map properties can be read as numbers whatever their type
+	lProperty.num_value = lProperty.type == MAP_PROPERTY_INT ? (float)aProperty.attribute("value").as_int() : aProperty.attribute("value").as_float();
+	lProperty.bool_value = aProperty.attribute("value").as_bool() ? 1 : 0;
+	lProperty.str_value = AddString(aProperty.attribute("value").as_string(""));
+	mProperties.push_back(lProperty);
+}
+
+void MapWriter::CompileTileset(pugi::xml_node& aNode)
+{
+	map_file_tileset lSet = {};
+	lSet.firstgid = aNode.attribute("firstgid").as_int();
+	lSet.tile_width = aNode.attribute("tilewidth").as_int();
+	lSet.tile_height = aNode.attribute("tileheight").as_int();
+	lSet.columns = aNode.attribute("columns").as_int();
+	lSet.total_tiles = aNode.attribute("tilecount").as_int();
+	lSet.image = AddString(aNode.child("image").attribute("source").as_string());
+	mTilesets.push_back(lSet);
+}
+
+void MapWriter::CompileBackground(pugi::xml_node& aNode)
+{
+	//same defaults as the engine uses when reading the xml
+	map_file_background lBack = {};
+	lBack.parallax_x = 1;
+	lBack.parallax_y = 1;
+	lBack.depth = 20;
+	lBack.repeat_y = 1;
+
+	for (pugi::xml_node iterator = aNode.child("properties").first_child(); iterator; iterator = iterator.next_sibling())
+	{
+		std::string lName = iterator.attribute("name").as_string();
+		if (lName == "depth")
+		{
+			lBack.depth = iterator.attribute("value").as_int(20);
+		}
+		else if (lName == "parallax_x")
+		{
+			lBack.parallax_x = iterator.attribute("value").as_float(1);
+		}
+		else if (lName == "parallax_y")
+		{
+			lBack.parallax_y = iterator.attribute("value").as_float(1);
+		}
+		else if (lName == "repeat_y")
+		{
+			lBack.repeat_y = iterator.attribute("value").as_bool(true) ? 1 : 0;
+		}
+	}
+
+	lBack.image = AddString(aNode.child("image").attribute("source").as_string());
+	mBackgrounds.push_back(lBack);
+}
+
+void MapWriter::CompileWalls(pugi::xml_node& aNode)
+{
+	for (pugi::xml_node iterator = aNode.child("object"); iterator; iterator = iterator.next_sibling())
+	{
+		map_file_wall lWall;
+		lWall.x = iterator.attribute("x").as_int();
+		lWall.y = iterator.attribute("y").as_int();
+		lWall.w = iterator.attribute("width").as_int();
+		lWall.h = iterator.attribute("height").as_int();
+		mWalls.push_back(lWall);
+	}
+}
+
+void MapWriter::CompileObjects(pugi::xml_node& aNode)
+{
+	for (pugi::xml_node iterator = aNode.child("object"); iterator; iterator = iterator.next_sibling())
+	{
+		map_file_object lObject = {};
+		lObject.x = iterator.attribute("x").as_int();
+		lObject.y = iterator.attribute("y").as_int();
+		lObject.w = iterator.attribute("width").as_int();
+		lObject.h = iterator.attribute("height").as_int();
+		lObject.type = AddString(iterator.attribute("type").as_string());
+
+		lObject.property_first = (uint32_t)mProperties.size();
+		for (pugi::xml_node property = iterator.child("properties").first_child(); property; property = property.next_sibling())
+		{
+			AddProperty(property);
+		}
+		lObject.property_count = (uint32_t)mProperties.size() - lObject.property_first;
+		mObjects.push_back(lObject);
+	}
+}
+
+bool MapWriter::CompileLayer(pugi::xml_node& aNode)
+{
+	map_file_layer lLayer = {};
+	lLayer.width = aNode.attribute("width").as_int();
+	lLayer.height = aNode.attribute("height").as_int();
+	lLayer.depth = 20;
+	lLayer.tileset = 0;
+
+	//the engine reads the parallax of the layers as whole numbers
+	int lParallaxX = 1;
+	int lParallaxY = 1;
+	for (pugi::xml_node iterator = aNode.child("properties").first_child(); iterator; iterator = iterator.next_sibling())
+	{
+		std::string lName = iterator.attribute("name").as_string();
+		if (lName == "depth")
+		{
+			lLayer.depth = iterator.attribute("value").as_int(20);
+		}
+		else if (lName == "parallax_x")
+		{
+			lParallaxX = (int)iterator.attribute("value").as_float(1);
+		}
+		else if (lName == "parallax_y")
+		{
+			lParallaxY = (int)iterator.attribute("value").as_float(1);
+		}
+		else if (lName == "tileset")
+		{
+			lLayer.tileset = iterator.attribute("value").as_uint(0);
+		}
+	}
+	lLayer.parallax_x = (float)lParallaxX;
+	lLayer.parallax_y = (float)lParallaxY;
+
+	if (lLayer.width <= 0 || lLayer.height <= 0 || lLayer.tileset >= mTilesets.size())
+	{
+		printf("layer %s has no size or uses a tileset that is not defined before it\n", aNode.attribute("name").as_string());
+		return false;
+	}
+
+	std::vector<uint32_t> lData((size_t)lLayer.width * lLayer.height);
+	uint32_t lFirstgid = mTilesets[lLayer.tileset].firstgid;
+	pugi::xml_node lDataNode = aNode.child("data");
+	const char* lEncoding = lDataNode.attribute("encoding").as_string();
+	if (lEncoding[0] != '\0')
+	{
+		std::string lError;
+		if (!DecodeTileData(lDataNode.child_value(), lEncoding, lDataNode.attribute("compression").as_string(), lData.data(), lData.size(), lError))
+		{
+			printf("layer %s: %s\n", aNode.attribute("name").as_string(), lError.c_str());
+			return false;
+		}
+		GidsToTileIds(lData.data(), lData.size(), lFirstgid);
+	}
+	else
+	{
+		pugi::xml_node lTile = lDataNode.first_child();
+		for (size_t i = 0; i < lData.size(); ++i)
+		{
+			lData[i] = lTile.attribute("gid").as_uint(MAP_FILE_EMPTY_TILE);
+			if (lData[i] != MAP_FILE_EMPTY_TILE)
+			{
+				lData[i] -= lFirstgid;
+			}
+			lTile = lTile.next_sibling();
+		}
+	}
+
+	mLayers.push_back(lLayer);
+	mLayerData.push_back(lData);
+	return true;
+}
+
+void MapWriter::CompileMapProperties(pugi::xml_node& aNode)
+{
+	mMapPropertyFirst = (uint32_t)mProperties.size();
+	for (pugi::xml_node iterator = aNode.first_child(); iterator; iterator = iterator.next_sibling())
+	{
+		AddProperty(iterator);
+	}
+	mMapPropertyCount = (uint32_t)mProperties.size() - mMapPropertyFirst;
+}
+
+bool MapWriter::Compile(const char* aTmxPath)
+{
+	pugi::xml_document lDocument;
+	pugi::xml_parse_result lResult = lDocument.load_file(aTmxPath);
+	if (!lResult)
+	{
+		printf("could not read %s: %s\n", aTmxPath, lResult.description());
+		return false;
+	}
+
+	pugi::xml_node lMap = lDocument.child("map");
+	for (pugi::xml_node iterator = lMap.first_child(); iterator; iterator = iterator.next_sibling())
+	{
+		std::string lName = iterator.name();
+		if (lName == "tileset")
+		{
+			CompileTileset(iterator);
+		}
+		else if (lName == "imagelayer")
+		{
+			CompileBackground(iterator);
+		}
+		else if (lName == "objectgroup")
+		{
+			bool lIsWallLayer = false;
+			for (pugi::xml_node property = iterator.child("properties").first_child(); property; property = property.next_sibling())
+			{
+				if (strcmp(property.attribute("name").value(), "isWallLayer") == 0)
+				{
+					lIsWallLayer = property.attribute("value").as_bool(false);
+				}
+			}
+
+			if (lIsWallLayer)
+			{
+				CompileWalls(iterator);
+			}
+			else
+			{
+				CompileObjects(iterator);
+			}
+		}
+		else if (lName == "layer")
+		{
+			if (!CompileLayer(iterator))
+			{
+				return false;
+			}
+		}
+		else if (lName == "properties")
+		{
+			CompileMapProperties(iterator);
+		}
+	}
+	return true;
+}
+
+//pads the blob to a multiple of 4 and returns where the next section starts
+static uint32_t AlignSection(std::vector<char>& aBlob)
+{
+	while (aBlob.size() % 4 != 0)
+	{
+		aBlob.push_back('\0');
+	}
+	return (uint32_t)aBlob.size();
+}
+
+template<class T>
+static uint32_t AppendSection(std::vector<char>& aBlob, const std::vector<T>& aRecords)
+{
+	uint32_t lOffset = AlignSection(aBlob);
+	if (!aRecords.empty())
+	{
+		const char* lBytes = (const char*)aRecords.data();
+		aBlob.insert(aBlob.end(), lBytes, lBytes + aRecords.size() * sizeof(T));
+	}
+	return lOffset;
+}
+
+bool MapWriter::Save(const char* aOutputPath)
+{
+	std::vector<char> lBlob(sizeof(map_file_header));
+
+	map_file_header lHeader = {};
+	lHeader.magic = MAP_FILE_MAGIC;
+	lHeader.version = MAP_FILE_VERSION;
+
+	//the tiles go first so the layer records can point at them
+	for (size_t i = 0; i < mLayers.size(); ++i)
+	{
+		mLayers[i].data_offset = AppendSection(lBlob, mLayerData[i]);
+	}
+
+	lHeader.tileset_count = (uint32_t)mTilesets.size();
+	lHeader.tilesets_offset = AppendSection(lBlob, mTilesets);
+	lHeader.layer_count = (uint32_t)mLayers.size();
+	lHeader.layers_offset = AppendSection(lBlob, mLayers);
+	lHeader.background_count = (uint32_t)mBackgrounds.size();
+	lHeader.backgrounds_offset = AppendSection(lBlob, mBackgrounds);
+	lHeader.wall_count = (uint32_t)mWalls.size();
+	lHeader.walls_offset = AppendSection(lBlob, mWalls);
+	lHeader.object_count = (uint32_t)mObjects.size();
+	lHeader.objects_offset = AppendSection(lBlob, mObjects);
+	lHeader.property_count = (uint32_t)mProperties.size();
+	lHeader.properties_offset = AppendSection(lBlob, mProperties);
+	lHeader.strings_size = (uint32_t)mStrings.size();
+	lHeader.strings_offset = AppendSection(lBlob, mStrings);
+	lHeader.map_property_first = mMapPropertyFirst;
+	lHeader.map_property_count = mMapPropertyCount;
+
+	lHeader.file_size = AlignSection(lBlob);
+	memcpy(lBlob.data(), &lHeader, sizeof(lHeader));
+
+	FILE* lFile = fopen(aOutputPath, "wb");
+	if (lFile == nullptr)
+	{
+		printf("could not write %s\n", aOutputPath);
+		return false;
+	}
+	bool lWritten = fwrite(lBlob.data(), 1, lBlob.size(), lFile) == lBlob.size();
+	fclose(lFile);
+
+	if (!lWritten)
+	{
+		printf("could not write %s\n", aOutputPath);
+		return false;
+	}
+
+	printf("%s: %u layers, %u walls, %u objects, %u bytes\n", aOutputPath, lHeader.layer_count, lHeader.wall_count, lHeader.object_count, lHeader.file_size);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: MapCompiler map.tmx [map%s]\n", MAP_FILE_EXTENSION);
+		return 1;
+	}
+
+	std::string lOutput;
+	if (argc >= 3)
+	{
+		lOutput = argv[2];
+	}
+	else
+	{
+		//next to the map, where the engine looks for it
+		lOutput = argv[1];
+		size_t lDot = lOutput.find_last_of('.');
+		size_t lSlash = lOutput.find_last_of("/\\");
+		if (lDot != std::string::npos && (lSlash == std::string::npos || lDot > lSlash))
+		{
+			lOutput.erase(lDot);
+		}
+		lOutput += MAP_FILE_EXTENSION;
+	}
+
+	MapWriter lWriter;
+	if (!lWriter.Compile(argv[1]) || !lWriter.Save(lOutput.c_str()))
+	{
+		return 1;
+	}
+	return 0;
+}